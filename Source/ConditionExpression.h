@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    ConditionExpression.h
+    Created: 19 Oct 2026 3:41:09pm
+    Author:  Boris Divjak
+
+    Turns a trigger condition typed in as a short expression into the
+    little program the engine runs for each step (SequencerCondition).
+    This only happens when the condition is changed, so none of the
+    string handling gets anywhere near the audio thread.
+
+        A:B         the A-th out of every B cycles (B is 1, 2, 4, 8 or 16)
+        prev        the step before this one fired
+        first       the first cycle only
+        fill        the fill switch is on
+        !x  not x   x & y  x and y   x | y  x or y   ( )
+
+    e.g. "!1:4", "prev & 1:2", "first | fill", "not (3:4 or fill)"
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cctype>
+#include <string>
+#include "SequencerEngine.h"
+
+//==============================================================================
+
+
+class ConditionExpression
+{
+public:
+    // returns false (and a reason in error) if the expression doesn't make sense.
+    // An empty expression compiles to an empty condition.
+    static bool compile (const std::string& text, SequencerCondition& result, std::string& error)
+    {
+        ConditionExpression parser (text);
+        result = {};
+        error.clear();
+
+        if (parser.skipSpaces() && parser.position == text.size())
+            return true;
+
+        if (parser.parseEither() && parser.skipSpaces() && parser.position != text.size())
+            parser.fail ("unexpected '" + text.substr (parser.position, 1) + "'");
+
+        if (parser.error.empty())
+            result = parser.condition;
+
+        error = parser.error;
+        return parser.error.empty();
+    }
+
+private:
+    explicit ConditionExpression (const std::string& t) : text (t) {}
+
+    // x | y | z ...
+    bool parseEither ()
+    {
+        if (! parseBoth()) return false;
+
+        while (accept ("|") || acceptWord ("or"))
+            if (! parseBoth() || ! emit (SequencerCondition::either, -1)) return false;
+
+        return true;
+    }
+
+    // x & y & z ...
+    bool parseBoth ()
+    {
+        if (! parseTerm()) return false;
+
+        while (accept ("&") || acceptWord ("and"))
+            if (! parseTerm() || ! emit (SequencerCondition::both, -1)) return false;
+
+        return true;
+    }
+
+    bool parseTerm ()
+    {
+        skipSpaces();
+
+        if (accept ("!") || acceptWord ("not"))
+            return parseTerm() && emit (SequencerCondition::negate, 0);
+
+        if (accept ("(")) {
+            if (! parseEither()) return false;
+            return accept (")") || fail ("missing ')'");
+        }
+
+        if (acceptWord ("prev"))    return emit (SequencerCondition::previous, 1);
+        if (acceptWord ("first"))   return emit (SequencerCondition::firstCycle, 1);
+        if (acceptWord ("fill"))    return emit (SequencerCondition::fill, 1);
+
+        if (position < text.size() && std::isdigit ((unsigned char) text[position])) {
+            auto a = readNumber();
+            if (! accept (":")) return fail ("expected A:B");
+            auto b = readNumber();
+
+            if (b != 1 && b != 2 && b != 4 && b != 8 && b != 16)   return fail ("B has to be 1, 2, 4, 8 or 16");
+            if (a < 1 || a > b)                                     return fail ("A has to be between 1 and B");
+
+            return emit (SequencerCondition::cycleOf, 1)
+                && emitByte (static_cast<std::uint8_t> (a)) && emitByte (static_cast<std::uint8_t> (b));
+        }
+
+        return fail (position < text.size() ? "unexpected '" + text.substr (position, 1) + "'" : "unfinished expression");
+    }
+
+    //==============================================================================
+    bool emit (SequencerCondition::Op op, int stackChange)
+    {
+        depth += stackChange;
+        if (depth > SequencerCondition::maxDepth) return fail ("too complicated");
+        return emitByte (op);
+    }
+
+    bool emitByte (std::uint8_t byte)
+    {
+        if (length >= SequencerCondition::maxLength) return fail ("too long");
+        condition.code[(std::size_t) length++] = byte;
+        return true;
+    }
+
+    bool skipSpaces ()
+    {
+        while (position < text.size() && std::isspace ((unsigned char) text[position])) ++position;
+        return true;
+    }
+
+    bool accept (const char* symbol)
+    {
+        skipSpaces();
+        if (text.compare (position, 1, symbol) != 0) return false;
+        ++position;
+        return true;
+    }
+
+    bool acceptWord (const std::string& word)
+    {
+        skipSpaces();
+        auto end = position;
+        while (end < text.size() && std::isalpha ((unsigned char) text[end])) ++end;
+
+        auto found = text.substr (position, end - position);
+        for (auto& c : found) c = static_cast<char> (std::tolower ((unsigned char) c));
+
+        if (found != word) return false;
+        position = end;
+        return true;
+    }
+
+    int readNumber ()
+    {
+        skipSpaces();
+        auto number = 0;
+        while (position < text.size() && std::isdigit ((unsigned char) text[position]) && number < 1000)
+            number = number * 10 + (text[position++] - '0');
+        return number;
+    }
+
+    bool fail (const std::string& reason)
+    {
+        if (error.empty()) error = reason;
+        return false;
+    }
+
+    const std::string& text;
+    std::size_t position = 0;
+    SequencerCondition condition;
+    int length = 0;
+    int depth = 0;
+    std::string error;
+};
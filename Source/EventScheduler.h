@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    EventScheduler.h
+    Created: 18 Oct 2026 7:26:40pm
+    Author:  Boris Divjak
+
+    A fixed-size, time-ordered queue of events, for anything that has to
+    happen later than the block it was decided in (swung or delayed steps,
+    ratchets, note-offs). Times are absolute sample counts, so events can
+    wait across any number of blocks. All the storage is allocated up
+    front, so it's safe to use on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+//==============================================================================
+
+
+template <typename Payload, int Capacity>
+class EventScheduler
+{
+public:
+    // returns false if the queue is full
+    bool schedule (std::int64_t time, const Payload& payload) noexcept
+    {
+        if (numEvents >= Capacity)
+            return false;
+
+        // events for the same time come out in the order they went in
+        auto index = numEvents++;
+        heap[(std::size_t) index] = { time, nextOrder++, payload };
+
+        while (index > 0)
+        {
+            auto parent = (index - 1) / 2;
+
+            if (! isEarlier (heap[(std::size_t) index], heap[(std::size_t) parent]))
+                break;
+
+            std::swap (heap[(std::size_t) index], heap[(std::size_t) parent]);
+            index = parent;
+        }
+
+        return true;
+    }
+
+    // calls handler (time, payload) for every event before endTime, in time order.
+    // The handler is free to schedule more events.
+    template <typename Handler>
+    void processUntil (std::int64_t endTime, Handler&& handler)
+    {
+        while (numEvents > 0 && heap[0].time < endTime)
+        {
+            auto entry = heap[0];
+            removeFirst();
+            handler (entry.time, entry.payload);
+        }
+    }
+
+    void clear () noexcept              { numEvents = 0; }
+    bool isEmpty () const noexcept      { return numEvents == 0; }
+    int size () const noexcept          { return numEvents; }
+
+private:
+    struct Entry
+    {
+        std::int64_t time;
+        std::uint64_t order;
+        Payload payload;
+    };
+
+    static bool isEarlier (const Entry& a, const Entry& b) noexcept
+    {
+        return a.time < b.time || (a.time == b.time && a.order < b.order);
+    }
+
+    void removeFirst () noexcept
+    {
+        heap[0] = heap[(std::size_t) --numEvents];
+
+        for (int index = 0;;)
+        {
+            auto left = index * 2 + 1;
+            auto right = left + 1;
+            auto earliest = index;
+
+            if (left < numEvents && isEarlier (heap[(std::size_t) left], heap[(std::size_t) earliest]))     earliest = left;
+            if (right < numEvents && isEarlier (heap[(std::size_t) right], heap[(std::size_t) earliest]))   earliest = right;
+
+            if (earliest == index)
+                break;
+
+            std::swap (heap[(std::size_t) index], heap[(std::size_t) earliest]);
+            index = earliest;
+        }
+    }
+
+    std::array<Entry, Capacity> heap;
+    int numEvents = 0;
+    std::uint64_t nextOrder = 0;
+};
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    InternalTransport.cpp
+    Created: 18 Oct 2026 4:49:07pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "InternalTransport.h"
+
+
+void InternalTransport::prepare (double newSampleRate)
+{
+    if (newSampleRate > 0) sampleRate = newSampleRate;
+
+    playing = false;
+    anchorPpq = 0.0;
+    samplesSinceAnchor = 0;
+    blockPpq = 0.0;
+}
+
+
+//==============================================================================
+
+
+TransportTracker::Change InternalTransport::update (bool shouldPlay, double bpm, int numSamples)
+{
+    auto change = TransportTracker::Change::none;
+
+    if (shouldPlay && ! playing) {
+        // like a hardware sequencer, always start from the top
+        anchorPpq = 0.0;
+        samplesSinceAnchor = 0;
+        change = TransportTracker::Change::started;
+    }
+    else if (! shouldPlay && playing) {
+        change = TransportTracker::Change::stopped;
+    }
+
+    playing = shouldPlay;
+
+    if (bpm > 0.0 && bpm != tempo) {
+        // start counting again from here, so the position doesn't jump
+        anchorPpq += samplesSinceAnchor * tempo / 60.0 / sampleRate;
+        samplesSinceAnchor = 0;
+        tempo = bpm;
+    }
+
+    blockPpq = anchorPpq + samplesSinceAnchor * tempo / 60.0 / sampleRate;
+
+    if (playing) samplesSinceAnchor += numSamples;
+
+    return change;
+}
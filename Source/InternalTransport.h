@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    InternalTransport.h
+    Created: 18 Oct 2026 4:48:53pm
+    Author:  Boris Divjak
+
+    A simple built-in transport for the standalone app, where there's no
+    host to tell us the song position. It counts samples from the moment
+    it's started, and works the position out from that count (rather than
+    adding up small increments), so it doesn't drift in long sessions.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TransportTracker.h"
+
+//==============================================================================
+
+
+class InternalTransport
+{
+public:
+    void prepare (double sampleRate);
+
+    // call once per block with the current settings, returns what happened to the transport
+    TransportTracker::Change update (bool shouldPlay, double bpm, int numSamples);
+
+    bool isPlaying () const             { return playing; }
+
+    // where the block passed to the last update() starts, in quarter notes
+    double getPpqPosition () const      { return blockPpq; }
+    double getPpqPerSample () const     { return playing ? tempo / 60.0 / sampleRate : 0.0; }
+    double getBpm () const              { return tempo; }
+
+private:
+    double sampleRate = 44100.0;
+    double tempo = 120.0;
+    bool playing = false;
+
+    // the position is anchorPpq plus however long we've been playing at the current tempo
+    double anchorPpq = 0.0;
+    juce::int64 samplesSinceAnchor = 0;
+    double blockPpq = 0.0;
+};
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    LazyChoiceBox.cpp
+    Created: 18 Oct 2026 9:32:19pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "LazyChoiceBox.h"
+
+
+LazyChoiceBox::LazyChoiceBox()
+{
+    addListener (this);
+}
+
+
+LazyChoiceBox::~LazyChoiceBox()
+{
+    removeListener (this);
+}
+
+
+void LazyChoiceBox::attachTo (juce::RangedAudioParameter& parameter, const juce::StringArray& optionList)
+{
+    options = &optionList;
+
+    attachment = std::make_unique<juce::ParameterAttachment> (parameter, [this] (float value) {
+        showOption (juce::roundToInt (value));
+    });
+    attachment->sendInitialUpdate();
+}
+
+
+//==============================================================================
+
+
+void LazyChoiceBox::showPopup()
+{
+    // first time it's opened - fill in the items
+    if (getNumItems() == 0 && options != nullptr) {
+        addItemList (*options, 1);
+        showSelectedOption();
+    }
+
+    juce::ComboBox::showPopup();
+}
+
+
+void LazyChoiceBox::comboBoxChanged (juce::ComboBox*)
+{
+    // picked from the list
+    auto index = getSelectedItemIndex();
+
+    // or typed in - which might still be one of the options
+    if (index < 0 && onCustomText != nullptr) {
+        auto text = getText().trim();
+        index = options != nullptr ? options->indexOf (text) : -1;
+
+        if (index < 0) {
+            onCustomText (text);
+            return;
+        }
+    }
+
+    if (index < 0) return;
+
+    auto changed = index != selectedOption;
+    selectedOption = index;
+
+    if (onOptionPicked != nullptr) onOptionPicked();
+
+    if (changed && attachment != nullptr)
+        attachment->setValueAsCompleteGesture (static_cast<float>(index));
+}
+
+
+void LazyChoiceBox::showOption (int index)
+{
+    if (options == nullptr || index == selectedOption) return;
+
+    selectedOption = juce::jlimit (0, options->size() - 1, index);
+    showSelectedOption();
+
+    if (onChange != nullptr) onChange();
+}
+
+
+void LazyChoiceBox::setCustomText (const juce::String& text)
+{
+    customText = text;
+    showSelectedOption();
+}
+
+
+void LazyChoiceBox::showSelectedOption ()
+{
+    if (customText.isNotEmpty())
+        setText (customText, juce::dontSendNotification);
+    else if (getNumItems() > 0)
+        setSelectedItemIndex (selectedOption, juce::dontSendNotification);
+    else if (options != nullptr && selectedOption >= 0)
+        setText ((*options)[selectedOption], juce::dontSendNotification);
+}
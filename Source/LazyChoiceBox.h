@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    LazyChoiceBox.h
+    Created: 18 Oct 2026 9:32:05pm
+    Author:  Boris Divjak
+
+    A ComboBox for a choice parameter that doesn't fill in its list of
+    items until it's first clicked - until then it just shows the name of
+    the selected option. The option names come from a list shared by all
+    the boxes using it, so opening the editor stays quick even with lots
+    of long dropdowns (e.g. 16 trigger conditions with 31 options each).
+
+    If the box is made editable, text typed in that isn't one of the
+    options is passed on to onCustomText, and whatever is set with
+    setCustomText() is shown instead of the selected option.
+
+    It can also be used without a parameter (e.g. for the program list):
+    give it the options with setOptions(), show the current one with
+    setSelectedOption(), and pick up changes in onOptionPicked.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class LazyChoiceBox  :  public juce::ComboBox,
+                        private juce::ComboBox::Listener
+{
+public:
+    LazyChoiceBox();
+    ~LazyChoiceBox() override;
+
+    // the option list has to outlive the box (normally it's a static list)
+    void attachTo (juce::RangedAudioParameter& parameter, const juce::StringArray& optionList);
+
+    // without a parameter (same goes for the list)
+    void setOptions (const juce::StringArray& optionList)   { options = &optionList; }
+    void setSelectedOption (int index)                      { showOption (index); }
+
+    // index of the selected option, whether or not the items have been filled in yet
+    int getSelectedOption () const      { return selectedOption; }
+
+    void showPopup () override;
+
+    // for editable boxes: called with typed text that isn't one of the options
+    std::function<void (const juce::String&)> onCustomText;
+    // called whenever an option is picked (even the one that's already selected)
+    std::function<void()> onOptionPicked;
+    void setCustomText (const juce::String& text);
+
+private:
+    void comboBoxChanged (juce::ComboBox*) override;
+    void showOption (int index);
+    void showSelectedOption ();
+
+    const juce::StringArray* options = nullptr;
+    juce::String customText;
+    std::unique_ptr<juce::ParameterAttachment> attachment;
+    int selectedOption = -1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LazyChoiceBox)
+};
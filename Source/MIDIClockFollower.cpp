@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    MIDIClockFollower.cpp
+    Created: 18 Oct 2026 3:31:24pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "MIDIClockFollower.h"
+
+
+void MIDIClockFollower::prepare (double newSampleRate)
+{
+    if (newSampleRate > 0) sampleRate = newSampleRate;
+    reset();
+}
+
+
+void MIDIClockFollower::reset ()
+{
+    blockStart = 0;
+    running = false;
+    nextClockPpq = 0.0;
+    lastClockPpq = 0.0;
+    startPpq = 0.0;
+    lastClockTime = -1;
+    locked = false;
+    blockPpq = 0.0;
+    blockEndPpq = 0.0;
+    blockPpqPerSample = 0.0;
+}
+
+
+//==============================================================================
+
+
+TransportTracker::Change MIDIClockFollower::update (const juce::MidiBuffer& midiMessages, int numSamples)
+{
+    auto change = TransportTracker::Change::none;
+
+    for (const auto metadata : midiMessages)
+    {
+        auto message = metadata.getMessage();
+        auto time = blockStart + metadata.samplePosition;
+
+        if (message.isMidiClock()) {
+            handleClock (time);
+        }
+        else if (message.isMidiStart()) {
+            // the first clock after a start is the first beat of the song
+            running = true;
+            nextClockPpq = lastClockPpq = startPpq = 0.0;
+            change = TransportTracker::Change::started;
+        }
+        else if (message.isMidiContinue()) {
+            running = true;
+            startPpq = nextClockPpq;
+            change = TransportTracker::Change::started;
+        }
+        else if (message.isMidiStop()) {
+            running = false;
+            change = TransportTracker::Change::stopped;
+        }
+        else if (message.isSongPositionPointer()) {
+            // song position is counted in sixteenth notes
+            nextClockPpq = lastClockPpq = startPpq = message.getSongPositionPointerMidiBeat() / 4.0;
+            if (running) change = TransportTracker::Change::jumped;
+        }
+    }
+
+    if (running && locked) {
+        blockPpqPerSample = 1.0 / (period * clocksPerQuarterNote);
+
+        // work out the position at the start of the block from the last tick, but
+        // never go backwards, or past the next tick before it has arrived
+        auto ppq = lastClockPpq + (static_cast<double> (blockStart) - filteredTime) * blockPpqPerSample;
+        auto lowest = change == TransportTracker::Change::none ? juce::jmax (startPpq, blockEndPpq) : startPpq;
+        blockPpq = juce::jlimit (lowest, juce::jmax (lowest, nextClockPpq), ppq);
+    }
+    else {
+        blockPpq = nextClockPpq;
+        blockPpqPerSample = 0.0;
+    }
+
+    blockEndPpq = juce::jmin (blockPpq + blockPpqPerSample * numSamples, juce::jmax (blockPpq, nextClockPpq));
+    blockStart += numSamples;
+
+    return change;
+}
+
+
+//==============================================================================
+
+
+void MIDIClockFollower::handleClock (juce::int64 time)
+{
+    auto interval = lastClockTime >= 0 ? static_cast<double> (time - lastClockTime) : 0.0;
+
+    // no clock for half a second or more (i.e. less than 5 BPM) - start locking on again
+    if (interval <= 0.0 || interval > sampleRate * 0.5) {
+        locked = false;
+    }
+
+    if (! locked) {
+        if (interval > 0.0 && interval <= sampleRate * 0.5) {
+            period = interval;
+            nextTime = static_cast<double> (time) + period;
+            locked = true;
+        }
+        filteredTime = static_cast<double> (time);
+    }
+    else {
+        auto error = static_cast<double> (time) - nextTime;
+
+        if (std::abs (error) > period * 0.5) {
+            // the tempo has changed too much to follow smoothly, so jump straight to it
+            period = interval;
+            filteredTime = static_cast<double> (time);
+            nextTime = filteredTime + period;
+        }
+        else {
+            // second order delay-locked loop (see F. Adriaensen, "Using a DLL to filter time")
+            auto omega = juce::MathConstants<double>::twoPi * bandwidth * period / sampleRate;
+            filteredTime = nextTime;
+            nextTime += juce::MathConstants<double>::sqrt2 * omega * error + period;
+            period += omega * omega * error;
+        }
+    }
+
+    lastClockTime = time;
+
+    // clock keeps coming while stopped, but only moves the song position while running
+    if (running) {
+        lastClockPpq = nextClockPpq;
+        nextClockPpq += 1.0 / clocksPerQuarterNote;
+    }
+}
+
+
+//==============================================================================
+
+
+bool MIDIClockFollower::isActive () const
+{
+    return lastClockTime >= 0 && blockStart - lastClockTime < static_cast<juce::int64> (sampleRate);
+}
+
+
+double MIDIClockFollower::getBpm () const
+{
+    return locked ? 60.0 * sampleRate / (period * clocksPerQuarterNote) : 120.0;
+}
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    MIDIClockFollower.h
+    Created: 18 Oct 2026 3:31:09pm
+    Author:  Boris Divjak
+
+    Works out the song position from incoming MIDI clock, Start, Stop,
+    Continue and Song Position Pointer messages, for when there's no host
+    playhead to follow (e.g. the standalone app).
+
+    Clock ticks are run through a delay-locked loop, which smooths out the
+    timing jitter of MIDI interfaces and gives a steady tempo estimate, so
+    positions in between ticks can be worked out to the sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TransportTracker.h"
+
+//==============================================================================
+
+
+class MIDIClockFollower
+{
+public:
+    void prepare (double sampleRate);
+    void reset ();
+
+    // reads the clock and transport messages in this block and
+    // returns what happened to the transport
+    TransportTracker::Change update (const juce::MidiBuffer& midiMessages, int numSamples);
+
+    // true while clock is coming in
+    bool isActive () const;
+    bool isRunning () const             { return running; }
+
+    // where the block passed to the last update() starts, in quarter notes
+    double getPpqPosition () const      { return blockPpq; }
+    double getPpqPerSample () const     { return blockPpqPerSample; }
+    double getBpm () const;
+
+private:
+    static constexpr double clocksPerQuarterNote = 24.0;
+    static constexpr double bandwidth = 0.5;    // of the delay-locked loop, in Hz
+
+    void handleClock (juce::int64 time);
+
+    double sampleRate = 44100.0;
+    juce::int64 blockStart = 0;     // samples since prepare()
+
+    bool running = false;
+    double nextClockPpq = 0.0;      // where the next clock tick will be
+    double lastClockPpq = 0.0;
+    double startPpq = 0.0;          // where we were last started from
+    juce::int64 lastClockTime = -1;
+
+    // delay-locked loop state
+    bool locked = false;
+    double filteredTime = 0.0;      // smoothed time of the last tick
+    double nextTime = 0.0;          // predicted time of the next tick
+    double period = 0.0;            // smoothed samples per tick
+
+    double blockPpq = 0.0;
+    double blockEndPpq = 0.0;
+    double blockPpqPerSample = 0.0;
+};
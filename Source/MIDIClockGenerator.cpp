@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    MIDIClockGenerator.cpp
+    Created: 18 Oct 2026 6:02:31pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "MIDIClockGenerator.h"
+
+
+void MIDIClockGenerator::process (const SequencerTimeline& timeline, TransportTracker::Change change, juce::MidiBuffer& output)
+{
+    if (change == TransportTracker::Change::stopped) {
+        output.addEvent (juce::MidiMessage::midiStop(), 0);
+        synced = false;
+    }
+
+    if (! timeline.playing || timeline.ppqPerSample <= 0.0) {
+        return;
+    }
+
+    if (change == TransportTracker::Change::started) {
+        sendPosition (timeline.ppqStart, true, output);
+    }
+    else if (change == TransportTracker::Change::jumped || ! synced) {
+        // receivers only take a new song position while stopped
+        output.addEvent (juce::MidiMessage::midiStop(), 0);
+        sendPosition (timeline.ppqStart, false, output);
+    }
+
+    // add every tick that falls within this block
+    auto ppqEnd = timeline.ppqStart + timeline.ppqPerSample * timeline.numSamples;
+
+    while (static_cast<double> (nextTick) / clocksPerQuarterNote < ppqEnd) {
+        auto offset = (static_cast<double> (nextTick) / clocksPerQuarterNote - timeline.ppqStart) / timeline.ppqPerSample;
+        auto samplePosition = offset <= 0.0 ? 0 : static_cast<int> (std::ceil (offset));
+
+        if (samplePosition >= timeline.numSamples)
+            break;
+
+        output.addEvent (juce::MidiMessage::midiClock(), samplePosition);
+        ++nextTick;
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIClockGenerator::sendPosition (double ppq, bool fromTheTop, juce::MidiBuffer& output)
+{
+    if (fromTheTop && ppq <= 0.0) {
+        // the first clock after a start is the first beat of the song
+        output.addEvent (juce::MidiMessage::midiStart(), 0);
+        nextTick = 0;
+    }
+    else {
+        // the song position is in sixteenth notes, and the first clock after a continue
+        // plays that position - so carry on from the next sixteenth note
+        auto sixteenths = juce::jlimit (0, 16383, static_cast<int> (std::ceil (ppq * 4.0 - 1.0e-9)));
+        output.addEvent (juce::MidiMessage::songPositionPointer (sixteenths), 0);
+        output.addEvent (juce::MidiMessage::midiContinue(), 0);
+        nextTick = static_cast<juce::int64> (sixteenths) * clocksPerSixteenth;
+    }
+
+    synced = true;
+}
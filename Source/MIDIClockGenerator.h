@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    MIDIClockGenerator.h
+    Created: 18 Oct 2026 6:02:14pm
+    Author:  Boris Divjak
+
+    Generates 24 ppqn MIDI clock plus Start, Stop, Continue and Song
+    Position Pointer messages from the sequencer's timeline, so gear
+    chained after Chance Machine can follow it. Every tick is placed at
+    the exact sample where it falls within the block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SequencerEngine.h"
+#include "TransportTracker.h"
+
+//==============================================================================
+
+
+class MIDIClockGenerator
+{
+public:
+    // forget where we were, so the next block re-sends the song position
+    void reset ()   { synced = false; }
+
+    // adds this block's clock and transport messages to the output buffer
+    void process (const SequencerTimeline& timeline, TransportTracker::Change change, juce::MidiBuffer& output);
+
+private:
+    static constexpr int clocksPerQuarterNote = 24;
+    static constexpr int clocksPerSixteenth = 6;
+
+    void sendPosition (double ppq, bool fromTheTop, juce::MidiBuffer& output);
+
+    bool synced = false;
+    juce::int64 nextTick = 0;   // number of the next clock tick since the start of the song
+};
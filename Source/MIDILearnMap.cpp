@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+    MIDILearnMap.cpp
+    Created: 19 Oct 2026 5:02:58pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "MIDILearnMap.h"
+
+
+MIDILearnMap::MIDILearnMap (juce::AudioProcessorValueTreeState& s) : state (s)
+{
+    for (auto& entry : table) entry = -1;
+    for (auto& value : pendingValues) value = -1.0f;
+}
+
+
+void MIDILearnMap::addParameter (const juce::String& paramID)
+{
+    jassert (numParameters < maxParameters);
+
+    if (auto* param = state.getParameter (paramID))
+        if (numParameters < maxParameters)
+            parameters[(size_t) numParameters++] = param;
+}
+
+
+//==============================================================================
+
+
+void MIDILearnMap::startLearning (const juce::String& paramID)
+{
+    learnedSlot = -1;
+    learning = findParameter (paramID);
+}
+
+
+void MIDILearnMap::stopLearning ()
+{
+    learning = -1;
+}
+
+
+juce::String MIDILearnMap::getLearningParameter () const
+{
+    auto parameter = learning.load();
+    return parameter >= 0 ? parameters[(size_t) parameter]->paramID : juce::String();
+}
+
+
+void MIDILearnMap::forget (const juce::String& paramID)
+{
+    auto parameter = findParameter (paramID);
+    if (parameter < 0) return;
+
+    setMapping (parameter, -1);
+    saveMappings();
+}
+
+
+juce::String MIDILearnMap::getMappingText (const juce::String& paramID) const
+{
+    auto slot = findSlot (findParameter (paramID));
+    if (slot < 0) return {};
+
+    return "CC " + juce::String (slot % numControllers) + ", ch " + juce::String (slot / numControllers + 1);
+}
+
+
+//==============================================================================
+
+
+void MIDILearnMap::handleController (int channel, int controller, int value) noexcept
+{
+    auto slot = (channel & 0x0f) * numControllers + (controller & 0x7f);
+    auto parameter = static_cast<int> (table[(size_t) slot].load (std::memory_order_relaxed));
+
+    // the first CC while learning is the one that's mapped
+    if (learning.load (std::memory_order_relaxed) >= 0) {
+        auto expected = -1;
+        if (learnedSlot.compare_exchange_strong (expected, slot))
+            parameter = learning.load (std::memory_order_relaxed);
+    }
+
+    if (parameter < 0) return;
+
+    // only the latest value counts, however many came in since the message thread last looked
+    pendingValues[(size_t) parameter].store (static_cast<float> (value) / 127.0f, std::memory_order_relaxed);
+    changed.store (true, std::memory_order_release);
+}
+
+
+void MIDILearnMap::update()
+{
+    if (! changed.exchange (false, std::memory_order_acquire)) return;
+
+    // a CC came in while learning (learning is left alone while still waiting for one)
+    auto slot = learnedSlot.load();
+
+    if (slot >= 0) {
+        auto parameter = learning.exchange (-1);
+        learnedSlot = -1;
+
+        if (parameter >= 0) {
+            setMapping (parameter, slot);
+            saveMappings();
+        }
+    }
+
+    for (auto i=0; i<numParameters; i++) {
+        auto value = pendingValues[(size_t) i].exchange (-1.0f);
+        if (value >= 0) parameters[(size_t) i]->setValueNotifyingHost (value);
+    }
+}
+
+
+//==============================================================================
+
+
+int MIDILearnMap::findParameter (const juce::String& paramID) const
+{
+    for (auto i=0; i<numParameters; i++) {
+        if (parameters[(size_t) i]->paramID == paramID) return i;
+    }
+
+    return -1;
+}
+
+
+int MIDILearnMap::findSlot (int parameter) const
+{
+    if (parameter < 0) return -1;
+
+    for (size_t i=0; i<table.size(); i++) {
+        if (table[i].load() == parameter) return static_cast<int> (i);
+    }
+
+    return -1;
+}
+
+
+void MIDILearnMap::setMapping (int parameter, int slot)
+{
+    // a parameter only follows one CC, and each CC only moves one parameter
+    for (auto& entry : table) {
+        if (entry.load() == parameter) entry = -1;
+    }
+
+    if (slot >= 0) table[(size_t) slot] = static_cast<juce::int8> (parameter);
+}
+
+
+void MIDILearnMap::saveMappings ()
+{
+    // kept with the rest of the state, so it's saved with the project
+    auto mappings = state.state.getOrCreateChildWithName ("MidiLearn", nullptr);
+    mappings.removeAllChildren (nullptr);
+
+    for (size_t i=0; i<table.size(); i++) {
+        auto parameter = static_cast<int> (table[i].load());
+        if (parameter < 0) continue;
+
+        juce::ValueTree mapping ("Mapping");
+        mapping.setProperty ("parameter", parameters[(size_t) parameter]->paramID, nullptr);
+        mapping.setProperty ("channel", static_cast<int> (i) / numControllers + 1, nullptr);
+        mapping.setProperty ("cc", static_cast<int> (i) % numControllers, nullptr);
+        mappings.appendChild (mapping, nullptr);
+    }
+}
+
+
+void MIDILearnMap::restore ()
+{
+    learning = -1;
+    for (auto& entry : table) entry = -1;
+
+    for (const auto& mapping : state.state.getChildWithName ("MidiLearn")) {
+        auto parameter = findParameter (mapping.getProperty ("parameter").toString());
+        auto channel = static_cast<int> (mapping.getProperty ("channel", 0)) - 1;
+        auto controller = static_cast<int> (mapping.getProperty ("cc", -1));
+
+        if (parameter < 0 || channel < 0 || channel >= numChannels || controller < 0 || controller >= numControllers)
+            continue;
+
+        table[(size_t) (channel * numControllers + controller)] = static_cast<juce::int8> (parameter);
+    }
+}
@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    MIDILearnMap.h
+    Created: 19 Oct 2026 5:02:37pm
+    Author:  Boris Divjak
+
+    MIDI learn, for hosts that don't make it easy to map controllers to
+    plugin parameters. Pick a parameter, move a controller, and from then
+    on that CC sets the parameter.
+
+    The audio thread looks each incoming CC up in a flat table with a slot
+    for every channel and controller number, so there's no searching, and
+    it only ever writes to atomics. Setting the parameters (and changing
+    the table when something is learned) is left to the message thread,
+    which picks them up from the processor's change poller - so a fast
+    controller sweep doesn't post a message for every CC, and nothing is
+    done while no CCs come in.
+    The mappings are kept in the plugin state, so they're saved with the
+    project.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class MIDILearnMap
+{
+public:
+    static constexpr int numChannels = 16;
+    static constexpr int numControllers = 128;
+    static constexpr int maxParameters = 64;
+
+    explicit MIDILearnMap (juce::AudioProcessorValueTreeState& s);
+
+    // message thread, before any audio is processed: a parameter that can be learned
+    void addParameter (const juce::String& paramID);
+
+    // message thread. The next CC that comes in is mapped to the parameter.
+    void startLearning (const juce::String& paramID);
+    void stopLearning ();
+    juce::String getLearningParameter () const;
+
+    void forget (const juce::String& paramID);
+    juce::String getMappingText (const juce::String& paramID) const;   // e.g. "CC 74, ch 1", or empty
+
+    // message thread: reads the mappings back from the state (after it's been replaced)
+    void restore ();
+
+    // audio thread: call for every incoming CC (channel 0-15)
+    void handleController (int channel, int controller, int value) noexcept;
+
+    // message thread, regularly: sets the parameters and maps what was learned
+    void update ();
+
+private:
+    int findParameter (const juce::String& paramID) const;
+    int findSlot (int parameter) const;
+    void setMapping (int parameter, int slot);
+    void saveMappings ();
+
+    juce::AudioProcessorValueTreeState& state;
+
+    std::array<juce::RangedAudioParameter*, maxParameters> parameters {};
+    int numParameters = 0;
+
+    // which parameter each channel and controller is mapped to (-1 = none), indexed by channel * 128 + CC
+    std::array<std::atomic<juce::int8>, numChannels * numControllers> table;
+
+    // the latest value for each parameter (0 - 1), waiting for the message thread (-1 = none)
+    std::array<std::atomic<float>, maxParameters> pendingValues;
+
+    std::atomic<int> learning { -1 };           // parameter waiting for a CC
+    std::atomic<int> learnedSlot { -1 };        // the CC that came in for it
+    std::atomic<bool> changed { false };        // something for update() to do
+
+    JUCE_DECLARE_NON_COPYABLE (MIDILearnMap)
+};
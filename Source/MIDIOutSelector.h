@@ -11,58 +11,26 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "PluginProcessor.h"
-
-//==============================================================================
-
-struct MidiDeviceListEntry : juce::ReferenceCountedObject
-{
-    MidiDeviceListEntry (juce::MidiDeviceInfo info) : deviceInfo (info) {}
-
-    juce::MidiDeviceInfo deviceInfo;
-    std::unique_ptr<juce::MidiOutput> outDevice;
-
-    using Ptr = juce::ReferenceCountedObjectPtr<MidiDeviceListEntry>;
-};
-
+#include "MIDIOutputRouter.h"
 
 //==============================================================================
+// Dropdown showing the MIDI outputs known to the router. It's only a view -
+// picking a device sets the 'midiSelect' parameter, and the router opens it.
 
 
 class MIDIOutSelector : public juce::ComboBox,
-                        private juce::Timer
+                        private juce::ChangeListener
 
 {
 public:
-    MIDIOutSelector(const juce::String & name, ChanceMachineAudioProcessor& p);
-    ~MIDIOutSelector();
-
-    void openDevice (int index);
-    void closeDevice (int index);
-    void closeAllDevices ();
-    void updateDeviceList (bool force = false);
-    bool hasDeviceListChanged ();
+    MIDIOutSelector(MIDIOutputRouter& router, juce::RangedAudioParameter& parameter);
+    ~MIDIOutSelector() override;
 
-    void closeUnpluggedDevices (const juce::Array<juce::MidiDeviceInfo>& currentlyPluggedInDevices);
-    juce::ReferenceCountedObjectPtr<MidiDeviceListEntry> findDevice (juce::MidiDeviceInfo device) const;
-    void sendToMidiOutputs (const juce::MidiMessage& msg);
-
-    void selectionChanged();
     void updateMidiDropdown ();
 
-    
-    std::unique_ptr<juce::AudioParameterFloat> createParameter();
-
-    juce::ReferenceCountedArray<MidiDeviceListEntry> midiOutputs;
-    juce::String midiId = "";
-
 private:
-    void timerCallback() override;
-    ChanceMachineAudioProcessor& audioProcessor;
-    std::string& statusMessage; // used for debugging
-};
-
-
-
-
+    void changeListenerCallback (juce::ChangeBroadcaster*) override;
 
+    MIDIOutputRouter& midiRouter;
+    juce::ParameterAttachment attachment;
+};
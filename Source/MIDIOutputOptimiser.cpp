@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    MIDIOutputOptimiser.cpp
+    Created: 18 Oct 2026 10:12:21am
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "MIDIOutputOptimiser.h"
+
+
+MIDIOutputOptimiser::MIDIOutputOptimiser()
+    : ports (new PortState[maxPorts])
+{
+    for (auto i=0; i<maxPorts; i++) {
+        clearPort (ports[(size_t) i]);
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputOptimiser::prepare (double newSampleRate)
+{
+    if (newSampleRate > 0) sampleRate = newSampleRate;
+    invalidateAll();
+}
+
+
+void MIDIOutputOptimiser::setMaxMessagesPerSecond (int messagesPerSecond)
+{
+    maxMessagesPerSecond = juce::jmax (0, messagesPerSecond);
+
+    // allow short bursts of up to 10ms worth of messages
+    maxTokens = juce::jmax (1.0, maxMessagesPerSecond * 0.01);
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputOptimiser::invalidatePort (int port)
+{
+    if (juce::isPositiveAndBelow (port, maxPorts))
+        ports[(size_t) port].invalidateRequested = true;
+}
+
+
+void MIDIOutputOptimiser::invalidateAll ()
+{
+    for (auto i=0; i<maxPorts; i++) {
+        invalidatePort (i);
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputOptimiser::beginBlock (int numSamples)
+{
+    auto refill = maxMessagesPerSecond * numSamples / sampleRate;
+
+    for (auto i=0; i<maxPorts; i++) {
+        auto& p = ports[(size_t) i];
+
+        if (p.invalidateRequested.exchange (false))
+            clearPort (p);
+
+        p.tokens = juce::jmin (maxTokens, p.tokens + refill);
+    }
+}
+
+
+//==============================================================================
+
+
+bool MIDIOutputOptimiser::filter (int port, const juce::MidiMessage& msg)
+{
+    if (! juce::isPositiveAndBelow (port, maxPorts))
+        return true;
+
+    auto& p = ports[(size_t) port];
+
+    // anything that isn't a CC (notes etc.) always goes out, but still uses up the port's budget
+    if (! msg.isController()) {
+        takeToken (p);
+        return true;
+    }
+
+    auto slot = (size_t) ((msg.getChannel() - 1) * 128 + msg.getControllerNumber());
+    auto value = static_cast<juce::uint8> (msg.getControllerValue());
+    auto& pending = p.pendingValues[slot];
+
+    // the receiver already has this value - drop it (and anything still waiting for this CC)
+    if (p.lastValues[slot] == value) {
+        if (pending != noValue) pending = value;
+        return false;
+    }
+
+    if (! hasBudget (p)) {
+        // hold on to the latest value and send it when there's room again
+        // each CC is only queued once, so the queue can't overflow
+        if (pending == noValue)
+            p.pendingSlots[(size_t) ((p.firstPending + p.numPending++) % numSlots)] = static_cast<juce::uint16> (slot);
+
+        pending = value;
+        return false;
+    }
+
+    if (pending != noValue) pending = value;
+    p.lastValues[slot] = value;
+    takeToken (p);
+    return true;
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputOptimiser::clearPort (PortState& p)
+{
+    p.lastValues.fill (noValue);
+    p.pendingValues.fill (noValue);
+    p.firstPending = 0;
+    p.numPending = 0;
+    p.tokens = maxTokens;
+}
+
+
+bool MIDIOutputOptimiser::hasBudget (const PortState& p) const
+{
+    return maxMessagesPerSecond == 0 || p.tokens >= 1.0;
+}
+
+
+void MIDIOutputOptimiser::takeToken (PortState& p)
+{
+    if (maxMessagesPerSecond > 0)
+        p.tokens = juce::jmax (0.0, p.tokens - 1.0);
+}
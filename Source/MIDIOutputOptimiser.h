@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    MIDIOutputOptimiser.h
+    Created: 18 Oct 2026 10:12:05am
+    Author:  Boris Divjak
+
+    Output stage that sits in front of the host MIDI buffer and every
+    external MIDI output. It drops CC messages that would not change the
+    value a receiver already has, and keeps each port under a configurable
+    message rate so slow DIN links shared with other gear don't clog up.
+
+    Only CCs are held back by the rate limit. Notes, clock and everything
+    else always go out on time (a late or missing note off is far worse
+    than a busy link), but on the external outputs they use up the port's
+    budget, so the CCs around them make way. The host's buffer isn't a
+    slow link, so only the step CCs go through filter() for it - notes and
+    forwarded messages are added to it directly and don't count.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class MIDIOutputOptimiser
+{
+public:
+    static constexpr int hostPort = 0;     // the host's MIDI buffer
+    static constexpr int maxPorts = 17;    // host + up to 16 external outputs
+
+    MIDIOutputOptimiser();
+
+    void prepare (double sampleRate);
+
+    // 0 means no limit
+    void setMaxMessagesPerSecond (int messagesPerSecond);
+
+    // can be called from any thread, the caches are cleared on the next block
+    void invalidatePort (int port);
+    void invalidateAll ();
+
+    // call at the start of each block, before any messages are filtered
+    void beginBlock (int numSamples);
+
+    // returns true if the message should be sent to the given port
+    bool filter (int port, const juce::MidiMessage& msg);
+
+    // sends CC values that were held back by the rate limit, as far as the
+    // port's budget allows, oldest first. Only the latest value of each CC is kept.
+    template <typename SendFunction>
+    void drainPending (int port, SendFunction&& send)
+    {
+        if (! juce::isPositiveAndBelow (port, maxPorts))
+            return;
+
+        auto& p = ports[(size_t) port];
+
+        while (p.numPending > 0 && hasBudget (p))
+        {
+            auto slot = p.pendingSlots[(size_t) p.firstPending];
+            p.firstPending = (p.firstPending + 1) % numSlots;
+            --p.numPending;
+            auto value = p.pendingValues[slot];
+            p.pendingValues[slot] = noValue;
+
+            if (value == p.lastValues[slot])
+                continue;
+
+            p.lastValues[slot] = value;
+            takeToken (p);
+            send (juce::MidiMessage::controllerEvent (slot / 128 + 1, slot % 128, value));
+        }
+    }
+
+private:
+    static constexpr juce::uint8 noValue = 0xff;
+    static constexpr int numSlots = 16 * 128;     // channel x controller
+
+    struct PortState
+    {
+        std::array<juce::uint8, numSlots> lastValues;
+        std::array<juce::uint8, numSlots> pendingValues;
+        std::array<juce::uint16, numSlots> pendingSlots;     // in the order they were held back
+        int firstPending = 0;
+        int numPending = 0;
+        double tokens = 0.0;
+        std::atomic<bool> invalidateRequested { true };
+    };
+
+    void clearPort (PortState& p);
+    bool hasBudget (const PortState& p) const;
+    void takeToken (PortState& p);
+
+    std::unique_ptr<PortState[]> ports;
+
+    double sampleRate = 44100.0;
+    int maxMessagesPerSecond = 0;
+    double maxTokens = 1.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MIDIOutputOptimiser)
+};
@@ -0,0 +1,484 @@
+/*
+  ==============================================================================
+
+    MIDIOutputRouter.cpp
+    Created: 18 Oct 2026 10:06:02pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "MIDIOutputRouter.h"
+
+
+//==============================================================================
+// One timer for all instances, which checks for MIDI devices being plugged in
+// or out and lets every router know when that happens (rather than every
+// instance checking on its own). It also gets rid of devices the audio
+// threads are done with.
+
+class MIDIOutputRouter::DeviceWatcher  :  private juce::Timer
+{
+public:
+    DeviceWatcher ()            { startTimer (500); }
+    ~DeviceWatcher () override  { stopTimer(); }
+
+    void add (MIDIOutputRouter* router)         { routers.add (router); }
+    void remove (MIDIOutputRouter* router)      { routers.remove (router); }
+
+private:
+    void timerCallback() override
+    {
+        auto devices = juce::MidiOutput::getAvailableDevices();
+
+        if (devices != lastDevices) {
+            lastDevices = devices;
+            routers.call ([] (MIDIOutputRouter& r) { r.updateDeviceListAsync(); });
+        }
+
+        routers.call ([] (MIDIOutputRouter& r) { r.deleteRetiredDevices(); });
+    }
+
+    juce::ListenerList<MIDIOutputRouter> routers;
+    juce::Array<juce::MidiDeviceInfo> lastDevices;
+};
+
+
+//==============================================================================
+
+
+MIDIOutputRouter::MIDIOutputRouter (ChanceMachineAudioProcessor& p) :
+    audioProcessor(p)
+
+{
+    deviceWatcher->add (this);
+    audioProcessor.state.addParameterListener ("midiSelect", this);
+    sharedBuffer.ensureSize (2048);
+    for (auto& buffer : outBuffers) buffer.ensureSize (2048);
+
+    // don't hold up the plugin constructor with the device scan
+    updateDeviceListAsync();
+}
+
+MIDIOutputRouter::~MIDIOutputRouter()
+
+{
+    audioProcessor.state.removeParameterListener ("midiSelect", this);
+    deviceWatcher->remove (this);
+    cancelPendingUpdate();
+    closeAllDevices();
+    midiOutputs.clear();
+    setSharedOutput (false);
+
+    // there's no audio thread any more by now
+    deleteRetiredDevices (true);
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::openDevice (int index)
+{
+    jassert (index < maxSelectableDevices);
+
+    if (midiOutputs[index]->outDevice.get() == nullptr) {
+        midiOutputs[index]->outDevice = juce::MidiOutput::openDevice (midiOutputs[index]->deviceInfo.identifier);
+
+        if (midiOutputs[index]->outDevice.get() != nullptr)
+            midiOutputs[index]->outDevice->startBackgroundThread();
+    }
+            
+    if (midiOutputs[index]->outDevice.get() != nullptr) {
+        // we don't know what the device received before, so send everything again
+        audioProcessor.midiOptimiser.invalidatePort (index + 1);
+        publishOutputs();
+    }
+    else {
+        DBG ("MidiDemo::openDevice: open output device for index = " << index << " failed!");
+    }
+}
+
+//==============================================================================
+
+
+void MIDIOutputRouter::closeDevice (int index)
+{
+    jassert (midiOutputs[index]->outDevice.get() != nullptr);
+
+    // the audio thread may still be sending to it, so it's only taken out of its copy
+    // of the list for now, and deleted once it has picked up the new one
+    auto device = std::move (midiOutputs[index]->outDevice);
+    publishOutputs();
+    retiredDevices.push_back ({ publishedGeneration, std::move (device) });
+
+    // ...which is now, if there's no audio thread
+    deleteRetiredDevices();
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::closeAllDevices ()
+{
+    for (auto i=0; i<midiOutputs.size(); i++) {
+        if (midiOutputs[i]->outDevice.get() != nullptr) closeDevice(i);
+    }
+}
+
+
+//==============================================================================
+
+
+bool MIDIOutputRouter::hasDeviceListChanged ()
+{
+    auto availableDevices = juce::MidiOutput::getAvailableDevices();
+
+    if (availableDevices.size() != midiOutputs.size())
+        return true;
+
+    for (auto i = 0; i < availableDevices.size(); ++i)
+        if (availableDevices[i] != midiOutputs[i]->deviceInfo)
+            return true;
+
+    return false;
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::updateDeviceList (bool force)
+{
+    TraceRecorder::Scope trace ("updateDeviceList");
+    int selectedDevice = -1;
+
+    if (hasDeviceListChanged () || midiOutputs.size() == 0 || force)
+    {
+        auto availableDevices = juce::MidiOutput::getAvailableDevices();
+        closeUnpluggedDevices (availableDevices);
+
+        juce::ReferenceCountedArray<MidiDeviceListEntry> newDeviceList;
+
+        // add all currently plugged-in devices to the device list
+        for (auto& newDevice : availableDevices)
+        {
+            MidiDeviceListEntry::Ptr entry = findDevice (newDevice);
+
+            if (entry == nullptr)
+                entry = new MidiDeviceListEntry (newDevice);
+
+            // add device to the midiouts list - this includes the unique identifier
+            newDeviceList.add (entry);
+                
+            // check state to see if device should be selected and opened
+            if (audioProcessor.initialised && newDeviceList.size() <= maxSelectableDevices) {
+                if (midiId == newDevice.identifier) {
+                    selectedDevice = newDeviceList.size() - 1;
+                }
+            }
+        }
+        
+        midiOutputs = newDeviceList;
+
+        // the selected device is kept open (rather than closed and opened again), the rest are closed
+        for (auto i=0; i<midiOutputs.size(); i++) {
+            if (i != selectedDevice && midiOutputs[i]->outDevice.get() != nullptr) closeDevice (i);
+        }
+
+        audioProcessor.midiOptimiser.invalidateAll();
+
+        juce::StringArray names;
+        for (auto& d : midiOutputs) names.add (d->deviceInfo.name);
+
+        {
+            const juce::SpinLock::ScopedLockType lock (deviceNamesLock);
+            deviceNames.swapWith (names);
+        }
+
+        // open the device that was supposed to be open
+        if (selectedDevice > -1) openDevice (selectedDevice);
+
+        // devices may have moved around, so make sure the parameter still points at the right one
+        updateParameter();
+
+        // let the dropdown (if there is one) know
+        sendChangeMessage();
+    }
+
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::updateDeviceListAsync (bool force)
+{
+    // safe to call from any thread - the update happens on the message thread
+    if (force) forceAsyncUpdate = true;
+    listUpdateRequested = true;
+    triggerAsyncUpdate();
+}
+
+
+void MIDIOutputRouter::parameterChanged (const juce::String&, float)
+{
+    // this can come from any thread (e.g. automation), so open the device on the message thread
+    selectionChanged = true;
+    triggerAsyncUpdate();
+}
+
+
+void MIDIOutputRouter::handleAsyncUpdate ()
+{
+    // the saved device wins over the saved parameter, as the order of the devices may have changed
+    if (listUpdateRequested.exchange (false)) {
+        updateDeviceList (forceAsyncUpdate.exchange (false));
+        selectionChanged = false;
+    }
+
+    if (selectionChanged.exchange (false)) {
+        if (auto* param = dynamic_cast<juce::AudioParameterChoice*> (audioProcessor.state.getParameter ("midiSelect")))
+            selectDevice (param->getIndex());
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::selectDevice (int choice)
+{
+    if (choice == getSelectedDevice()) return;
+
+    closeAllDevices();
+    midiId = "";
+
+    auto index = choice - 1;
+
+    if (index >= 0 && index < juce::jmin (midiOutputs.size(), maxSelectableDevices)) {
+        openDevice (index);
+        midiId = midiOutputs[index]->deviceInfo.identifier;
+    }
+}
+
+
+int MIDIOutputRouter::getSelectedDevice () const
+{
+    for (auto i=0; i<midiOutputs.size(); i++) {
+        if (midiOutputs[i]->outDevice.get() != nullptr) return i + 1;
+    }
+
+    return 0;
+}
+
+
+void MIDIOutputRouter::publishOutputs ()
+{
+    auto& snapshot = outputSnapshots.getWriteBuffer();
+    snapshot = {};
+
+    for (auto i=0; i<juce::jmin (midiOutputs.size(), maxSelectableDevices); i++) {
+        if (auto* device = midiOutputs[i]->outDevice.get()) {
+            snapshot.devices[(size_t) i] = device;
+            snapshot.numOpen++;
+        }
+    }
+
+    snapshot.generation = ++publishedGeneration;
+    outputSnapshots.publish();
+
+    deleteRetiredDevices();
+}
+
+
+void MIDIOutputRouter::deleteRetiredDevices (bool all)
+{
+    // with no audio thread, the next block starts with the latest copy anyway
+    auto inUse = processing ? audioGeneration.load (std::memory_order_acquire) : publishedGeneration;
+
+    for (auto i = static_cast<int> (retiredDevices.size()); --i >= 0;) {
+        auto& retired = retiredDevices[(size_t) i];
+
+        if (all || retired.generation <= inUse) {
+            retired.device->stopBackgroundThread();
+            retiredDevices.erase (retiredDevices.begin() + i);
+        }
+    }
+}
+
+
+juce::String MIDIOutputRouter::getDeviceName (int index) const
+{
+    const juce::SpinLock::ScopedLockType lock (deviceNamesLock);
+    return deviceNames[index];
+}
+
+
+void MIDIOutputRouter::updateParameter ()
+{
+    if (auto* param = dynamic_cast<juce::AudioParameterChoice*> (audioProcessor.state.getParameter ("midiSelect"))) {
+        auto choice = getSelectedDevice();
+
+        if (param->getIndex() != choice)
+            param->setValueNotifyingHost (param->convertTo0to1 (static_cast<float> (choice)));
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::closeUnpluggedDevices (const juce::Array<juce::MidiDeviceInfo>& currentlyPluggedInDevices)
+{
+    for (auto i = midiOutputs.size(); --i >= 0;)
+    {
+        auto& d = *midiOutputs[i];
+
+        if (! currentlyPluggedInDevices.contains (d.deviceInfo))
+        {
+            if (d.outDevice.get() != nullptr) closeDevice (i);
+            midiOutputs.remove (i);
+        }
+    }
+}
+
+
+//==============================================================================
+
+
+juce::ReferenceCountedObjectPtr<MidiDeviceListEntry> MIDIOutputRouter::findDevice (juce::MidiDeviceInfo device) const
+{
+    for (auto& d : midiOutputs)
+        if (d->deviceInfo == device)
+            return d;
+
+    return nullptr;
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::beginBlock ()
+
+{
+    // from here on the old copy isn't used any more, so its devices can go
+    if (outputSnapshots.update())
+        audioGeneration.store (outputSnapshots.read().generation, std::memory_order_release);
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::sendToMidiOutputs (const juce::MidiMessage& msg, int samplePosition)
+
+{
+    TraceRecorder::Scope trace ("sendToMidiOutputs");
+
+    // the ring has no bandwidth limit, so nothing is held back from it
+    if (sharedOutputOn.load (std::memory_order_relaxed)) {
+        sharedBuffer.addEvent (msg, samplePosition);
+    }
+
+    auto& outputs = outputSnapshots.read();
+    if (outputs.numOpen == 0) return;
+
+    for (auto i=0; i<maxSelectableDevices; i++) {
+        if (outputs.devices[(size_t) i] == nullptr) continue;
+
+        // port 0 is the host, so external outputs start at 1
+        if (audioProcessor.midiOptimiser.filter (i + 1, msg)) {
+            sendToMidiOutput (i, msg, samplePosition);
+        }
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::sendPendingToMidiOutputs ()
+
+{
+    auto& outputs = outputSnapshots.read();
+
+    for (auto i=0; i<maxSelectableDevices; i++) {
+        if (outputs.devices[(size_t) i] == nullptr) continue;
+
+        audioProcessor.midiOptimiser.drainPending (i + 1, [this, i] (const juce::MidiMessage& msg) {
+            sendToMidiOutput (i, msg, 0);
+        });
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::sendToMidiOutput (int index, const juce::MidiMessage& msg, int samplePosition)
+
+{
+    if (outputSnapshots.read().devices[(size_t) index] != nullptr) {
+        outBuffers[(size_t) index].addEvent (msg, samplePosition);
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::flushMidiOutputs (double blockStartMs, double sampleRate)
+
+{
+    // sample positions within the block become times relative to the start
+    // of the block, so messages keep the spacing they have in the host's buffer
+    auto& outputs = outputSnapshots.read();
+
+    for (auto i=0; i<maxSelectableDevices; i++) {
+        auto* device = outputs.devices[(size_t) i];
+        auto& buffer = outBuffers[(size_t) i];
+
+        if (device != nullptr && ! buffer.isEmpty()) {
+            jassert(device->isBackgroundThreadRunning());
+            device->sendBlockOfMessages(
+                buffer,
+                blockStartMs,
+                sampleRate );
+            buffer.clear();
+        }
+    }
+
+    // the ring gets the same times as the devices. If it's being opened or
+    // closed right now, this block is skipped rather than waiting.
+    if (! sharedBuffer.isEmpty()) {
+        const juce::SpinLock::ScopedTryLockType lock (sharedRingLock);
+
+        if (lock.isLocked())
+            sharedRing.publish (sharedBuffer, blockStartMs, sampleRate);
+
+        sharedBuffer.clear();
+    }
+}
+
+
+//==============================================================================
+
+
+void MIDIOutputRouter::setSharedOutput (bool shouldBeOn)
+{
+    {
+        const juce::SpinLock::ScopedLockType lock (sharedRingLock);
+
+        if (shouldBeOn && ! sharedRing.isOpen())    sharedRing.create();
+        else if (! shouldBeOn)                      sharedRing.close();
+
+        sharedOutputOn = sharedRing.isOpen();
+    }
+
+    audioProcessor.state.state.setProperty ("sharedOut", sharedOutputOn.load(), nullptr);
+    sendChangeMessage();
+}
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    MIDIOutputRouter.h
+    Created: 18 Oct 2026 10:05:48pm
+    Author:  Boris Divjak
+
+    Keeps track of the external MIDI outputs, opens the one picked with
+    the 'midiSelect' parameter and sends messages to it. It has no GUI
+    parts, so instances without an open editor don't carry any - the
+    MIDIOutSelector dropdown is only created by the editor, and just shows
+    what's in here. Changes to the list of devices are broadcast, so the
+    dropdown can update itself.
+
+    The list of devices belongs to the message thread. The audio thread
+    gets its own copy of the open ones (through a TripleBuffer), picked up
+    at the start of each block, and a device that's closed is only deleted
+    once the audio thread has moved on to a copy without it (or straight
+    away, when no audio is being processed).
+
+    Everything sent to the outputs can also be copied to a shared memory
+    ring (see SharedEventRing), for programs that read it directly instead
+    of going through a virtual MIDI device.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SharedEventRing.h"
+#include "MIDIOutputOptimiser.h"
+#include "TraceRecorder.h"
+#include "TripleBuffer.h"
+
+class ChanceMachineAudioProcessor;
+
+//==============================================================================
+
+struct MidiDeviceListEntry : juce::ReferenceCountedObject
+{
+    MidiDeviceListEntry (juce::MidiDeviceInfo info) : deviceInfo (info) {}
+
+    juce::MidiDeviceInfo deviceInfo;
+    std::unique_ptr<juce::MidiOutput> outDevice;
+
+    using Ptr = juce::ReferenceCountedObjectPtr<MidiDeviceListEntry>;
+};
+
+
+//==============================================================================
+
+
+class MIDIOutputRouter  :   public juce::ChangeBroadcaster,
+                            private juce::AudioProcessorValueTreeState::Listener,
+                            private juce::AsyncUpdater
+{
+public:
+    // the 'midiSelect' parameter has a fixed number of slots, so only the first
+    // few devices can be picked (the dropdown shows the rest, but greyed out)
+    static constexpr int maxSelectableDevices = MIDIOutputOptimiser::maxPorts - 1;
+
+    MIDIOutputRouter (ChanceMachineAudioProcessor& p);
+    ~MIDIOutputRouter() override;
+
+    void openDevice (int index);
+    void closeDevice (int index);
+    void closeAllDevices ();
+    void updateDeviceList (bool force = false);
+    void updateDeviceListAsync (bool force = false);
+    bool hasDeviceListChanged ();
+
+    void closeUnpluggedDevices (const juce::Array<juce::MidiDeviceInfo>& currentlyPluggedInDevices);
+    juce::ReferenceCountedObjectPtr<MidiDeviceListEntry> findDevice (juce::MidiDeviceInfo device) const;
+
+    // from prepareToPlay and releaseResources: whether the audio thread may be using the outputs
+    void setProcessing (bool isProcessing)  { processing = isProcessing; }
+
+    // audio thread: call at the start of each block, before anything is sent
+    void beginBlock ();
+    void sendToMidiOutputs (const juce::MidiMessage& msg, int samplePosition = 0);
+    void sendPendingToMidiOutputs ();
+    void flushMidiOutputs (double blockStartMs, double sampleRate);
+
+    // audio thread: whether anything sent with sendToMidiOutputs() goes anywhere
+    bool isSending () const                 { return sharedOutputOn || outputSnapshots.read().numOpen > 0; }
+
+    // 0 is 'none' (host only), 1 and up are the devices in midiOutputs
+    void selectDevice (int choice);
+    int getSelectedDevice () const;
+
+    // any thread: the name of a device in midiOutputs (hosts ask for parameter text
+    // from wherever they like, while the list can change on the message thread)
+    juce::String getDeviceName (int index) const;
+
+    // publish to a shared memory ring as well (not from the audio thread)
+    void setSharedOutput (bool shouldBeOn);
+    int getSharedRingNumber () const        { return sharedRing.getRingNumber(); }
+
+    // message thread only (the audio thread has its own copy, see below)
+    juce::ReferenceCountedArray<MidiDeviceListEntry> midiOutputs;
+    juce::String midiId = "";
+
+private:
+    // the open devices, as the audio thread sees them
+    struct OutputSnapshot
+    {
+        std::array<juce::MidiOutput*, maxSelectableDevices> devices {};    // by port - 1, nullptr if closed
+        int numOpen = 0;
+        juce::int64 generation = 0;
+    };
+
+    struct RetiredDevice
+    {
+        juce::int64 generation;     // the first copy without it
+        std::unique_ptr<juce::MidiOutput> device;
+    };
+
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    void sendToMidiOutput (int index, const juce::MidiMessage& msg, int samplePosition);
+    void updateParameter ();
+    void publishOutputs ();
+    void deleteRetiredDevices (bool all = false);
+
+    class DeviceWatcher;
+    juce::SharedResourcePointer<DeviceWatcher> deviceWatcher;
+
+    ChanceMachineAudioProcessor& audioProcessor;
+    std::atomic<bool> listUpdateRequested { false };
+    std::atomic<bool> forceAsyncUpdate { false };
+    std::atomic<bool> selectionChanged { false };
+
+    juce::StringArray deviceNames;          // copy of the names in midiOutputs...
+    mutable juce::SpinLock deviceNamesLock; // ...swapped in whole, so readers never see it half done
+
+    TripleBuffer<OutputSnapshot> outputSnapshots;
+    juce::int64 publishedGeneration = 0;                // message thread
+    std::atomic<juce::int64> audioGeneration { 0 };     // the copy the audio thread is using
+    std::atomic<bool> processing { false };             // between prepareToPlay and releaseResources
+    std::vector<RetiredDevice> retiredDevices;          // closed, but maybe still in use by the audio thread
+    std::array<juce::MidiBuffer, maxSelectableDevices> outBuffers;   // audio thread: messages for the current block, sent all at once at the end
+
+    SharedEventRing sharedRing;
+    juce::SpinLock sharedRingLock;          // the audio thread only ever tries it
+    std::atomic<bool> sharedOutputOn { false };
+    juce::MidiBuffer sharedBuffer;          // audio thread: messages for the ring in the current block
+};
@@ -0,0 +1,240 @@
+/*
+  ==============================================================================
+
+    MIDITakeRecorder.cpp
+    Created: 19 Oct 2026 2:35:20pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "MIDITakeRecorder.h"
+
+
+MIDITakeRecorder::MIDITakeRecorder() : juce::Thread ("MIDI take recorder")
+{
+}
+
+MIDITakeRecorder::~MIDITakeRecorder()
+{
+    stop();
+}
+
+
+//==============================================================================
+
+
+bool MIDITakeRecorder::start (const juce::File& file)
+{
+    stop();
+
+    file.getParentDirectory().createDirectory();
+    file.deleteFile();
+
+    stream = std::make_unique<juce::FileOutputStream> (file, 65536);
+
+    if (! stream->openedOk()) {
+        stream.reset();
+        return false;
+    }
+
+    // a type 0 file with one track - its length is filled in when the take is finished
+    stream->write ("MThd", 4);
+    stream->writeIntBigEndian (6);
+    stream->writeShortBigEndian (0);
+    stream->writeShortBigEndian (1);
+    stream->writeShortBigEndian (ticksPerQuarterNote);
+    stream->write ("MTrk", 4);
+    stream->writeIntBigEndian (0);
+
+    takeFile = file;
+    trackStart = stream->getPosition();
+    lastTick = 0;
+    for (auto& channel : heldNotes) channel.fill (false);
+
+    // nothing's writing to it any more (stop() waited for that)
+    fifo.reset();
+
+    // start counting from the next block
+    restartRequested = true;
+    recording = true;
+    startThread();
+    return true;
+}
+
+
+juce::File MIDITakeRecorder::stop ()
+{
+    if (stream == nullptr) return {};
+
+    recording = false;
+
+    // an audio thread that got past the check in addBlock() before this may still be
+    // pushing (one that comes along after it sees recording is off)
+    while (activeWriters.load() > 0)
+        std::this_thread::yield();
+
+    stopThread (2000);
+
+    // anything still in the queue, note-offs for the notes that are still held (at the
+    // end of the last block, which nothing moves on any more), then the end of the track
+    writeEvents();
+    writeHeldNoteOffs (juce::jmax (lastTick, static_cast<juce::int64> (tickPosition)));
+    writeVariableLength (0);
+    stream->writeByte ((char) 0xff);
+    stream->writeByte (0x2f);
+    stream->writeByte (0);
+
+    auto trackLength = stream->getPosition() - trackStart;
+    stream->setPosition (trackStart - 4);
+    stream->writeIntBigEndian (static_cast<int> (trackLength));
+    stream->flush();
+    stream.reset();
+
+    return takeFile;
+}
+
+
+//==============================================================================
+
+
+void MIDITakeRecorder::addBlock (const juce::MidiBuffer& buffer, int numSamples, double bpm, double sampleRate)
+{
+    if (! recording || sampleRate <= 0 || bpm <= 0) return;
+
+    // counted before checking again, so stop() either waits for this or this sees it stopped
+    ++activeWriters;
+
+    if (recording)
+        addEvents (buffer, numSamples, bpm, sampleRate);
+
+    --activeWriters;
+}
+
+
+void MIDITakeRecorder::addEvents (const juce::MidiBuffer& buffer, int numSamples, double bpm, double sampleRate)
+{
+    if (restartRequested.exchange (false)) {
+        tickPosition = 0;
+        lastBpm = 0;
+    }
+
+    // tempo changes go in the file too, so the take lines up with the bars it was played in
+    if (bpm != lastBpm) {
+        Event tempo;
+        tempo.tick = static_cast<juce::int64> (tickPosition);
+        tempo.microsecondsPerQuarterNote = juce::roundToInt (60000000.0 / bpm);
+        push (tempo);
+        lastBpm = bpm;
+    }
+
+    auto ticksPerSample = bpm / 60.0 / sampleRate * ticksPerQuarterNote;
+
+    for (const auto metadata : buffer)
+    {
+        // clock, song position and sysex messages don't belong in the take
+        if (metadata.numBytes > 3 || metadata.data[0] >= 0xf0) continue;
+
+        Event event;
+        event.tick = static_cast<juce::int64> (tickPosition + metadata.samplePosition * ticksPerSample);
+        event.numBytes = static_cast<juce::uint8> (metadata.numBytes);
+        std::copy (metadata.data, metadata.data + metadata.numBytes, event.bytes.begin());
+        push (event);
+    }
+
+    tickPosition += numSamples * ticksPerSample;
+}
+
+
+void MIDITakeRecorder::push (const Event& event)
+{
+    // if the writer can't keep up, events are dropped rather than holding up the audio thread
+    if (fifo.getFreeSpace() < 1) return;
+
+    const auto scope = fifo.write (1);
+    if (scope.blockSize1 > 0)       queue[(size_t) scope.startIndex1] = event;
+    else if (scope.blockSize2 > 0)  queue[(size_t) scope.startIndex2] = event;
+}
+
+
+//==============================================================================
+
+
+void MIDITakeRecorder::run()
+{
+    while (! threadShouldExit())
+    {
+        writeEvents();
+        wait (20);
+    }
+}
+
+
+void MIDITakeRecorder::writeEvents ()
+{
+    while (fifo.getNumReady() > 0)
+    {
+        Event event;
+        {
+            const auto scope = fifo.read (1);
+            event = scope.blockSize1 > 0 ? queue[(size_t) scope.startIndex1] : queue[(size_t) scope.startIndex2];
+        }
+
+        // times in the file are the distance from the event before
+        writeVariableLength (static_cast<juce::uint32> (juce::jmax ((juce::int64) 0, event.tick - lastTick)));
+        lastTick = juce::jmax (lastTick, event.tick);
+
+        if (event.numBytes == 0) {
+            auto tempo = event.microsecondsPerQuarterNote;
+            stream->writeByte ((char) 0xff);
+            stream->writeByte (0x51);
+            stream->writeByte (3);
+            stream->writeByte ((char) ((tempo >> 16) & 0xff));
+            stream->writeByte ((char) ((tempo >> 8) & 0xff));
+            stream->writeByte ((char) (tempo & 0xff));
+        }
+        else {
+            stream->write (event.bytes.data(), event.numBytes);
+
+            auto status = event.bytes[0] & 0xf0;
+            if (event.numBytes == 3 && (status == 0x90 || status == 0x80))
+                heldNotes[(size_t) (event.bytes[0] & 0x0f)][(size_t) (event.bytes[1] & 0x7f)] = status == 0x90 && event.bytes[2] > 0;
+        }
+    }
+}
+
+
+void MIDITakeRecorder::writeHeldNoteOffs (juce::int64 tick)
+{
+    for (size_t channel = 0; channel < heldNotes.size(); ++channel) {
+        for (size_t note = 0; note < heldNotes[channel].size(); ++note) {
+            if (! heldNotes[channel][note]) continue;
+
+            writeVariableLength (static_cast<juce::uint32> (juce::jmax ((juce::int64) 0, tick - lastTick)));
+            lastTick = juce::jmax (lastTick, tick);
+
+            stream->writeByte ((char) (0x80 | channel));
+            stream->writeByte ((char) note);
+            stream->writeByte (0);
+            heldNotes[channel][note] = false;
+        }
+    }
+}
+
+
+void MIDITakeRecorder::writeVariableLength (juce::uint32 value)
+{
+    // 7 bits per byte, most significant first, with the top bit set on all but the last
+    juce::uint8 bytes[5];
+    auto numBytes = 0;
+
+    do {
+        bytes[numBytes++] = static_cast<juce::uint8> (value & 0x7f);
+        value >>= 7;
+    } while (value > 0);
+
+    while (--numBytes > 0)
+        stream->writeByte ((char) (bytes[numBytes] | 0x80));
+
+    stream->writeByte ((char) bytes[0]);
+}
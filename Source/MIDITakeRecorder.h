@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    MIDITakeRecorder.h
+    Created: 19 Oct 2026 2:34:52pm
+    Author:  Boris Divjak
+
+    Records what the plugin actually sends out (the notes and CCs that
+    made it through the dice rolls) to a Standard MIDI File, so a good
+    take can be kept. The audio thread only puts events in a lock-free
+    queue - a background thread writes them to the file as it goes, so
+    memory use stays the same no matter how long the take is. Notes still
+    held when the take is stopped get their note-offs at the end of it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class MIDITakeRecorder  :  private juce::Thread
+{
+public:
+    MIDITakeRecorder();
+    ~MIDITakeRecorder() override;
+
+    // message thread
+    bool start (const juce::File& file);
+    juce::File stop ();     // finishes the file and returns it
+    bool isRecording () const               { return recording; }
+
+    // audio thread: call at the end of each block with everything that was sent out
+    void addBlock (const juce::MidiBuffer& buffer, int numSamples, double bpm, double sampleRate);
+
+private:
+    struct Event
+    {
+        juce::int64 tick = 0;
+        juce::uint8 numBytes = 0;           // 0 is a tempo change
+        std::array<juce::uint8, 3> bytes {};
+        juce::int32 microsecondsPerQuarterNote = 0;
+    };
+
+    void addEvents (const juce::MidiBuffer& buffer, int numSamples, double bpm, double sampleRate);
+    void push (const Event& event);
+    void run() override;
+    void writeEvents ();
+    void writeHeldNoteOffs (juce::int64 tick);
+    void writeVariableLength (juce::uint32 value);
+
+    static constexpr int ticksPerQuarterNote = 960;
+    static constexpr int queueSize = 4096;
+
+    juce::AbstractFifo fifo { queueSize };
+    std::array<Event, queueSize> queue;
+
+    std::atomic<bool> recording { false };
+    std::atomic<bool> restartRequested { false };
+    std::atomic<int> activeWriters { 0 };      // audio threads inside addBlock()
+
+    // audio thread only (and stop(), once no audio thread is in addBlock)
+    double tickPosition = 0;
+    double lastBpm = 0;
+
+    // writer only (the background thread, or the message thread once it's stopped)
+    juce::File takeFile;
+    std::unique_ptr<juce::FileOutputStream> stream;     // buffered, so it's written in chunks
+    juce::int64 lastTick = 0;
+    juce::int64 trackStart = 0;
+    std::array<std::array<bool, 128>, 16> heldNotes {};     // by channel and note
+};
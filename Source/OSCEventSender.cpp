@@ -0,0 +1,182 @@
+/*
+  ==============================================================================
+
+    OSCEventSender.cpp
+    Created: 19 Oct 2026 9:14:37am
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "OSCEventSender.h"
+
+
+OSCEventSender::OSCEventSender() : juce::Thread ("OSC sender")
+{
+}
+
+OSCEventSender::~OSCEventSender()
+{
+    stopThread (1000);
+}
+
+
+//==============================================================================
+
+
+void OSCEventSender::setPort (int newPort)
+{
+    port = juce::jlimit (0, 65535, newPort);
+
+    // only run the thread while it's needed
+    if (port > 0)   { startThread(); notify(); }
+    else            stopThread (1000);
+}
+
+
+//==============================================================================
+
+
+void OSCEventSender::addStep (double timeMs, int step, bool on, juce::int64 cycle)
+{
+    Event event;
+    event.type = Event::Type::step;
+    event.timeMs = timeMs;
+    event.step = static_cast<juce::int16> (step);
+    event.on = on;
+    event.cycle = static_cast<juce::int32> (cycle);
+    push (event);
+}
+
+
+void OSCEventSender::addTrigger (double timeMs, int step)
+{
+    Event event;
+    event.type = Event::Type::trigger;
+    event.timeMs = timeMs;
+    event.step = static_cast<juce::int16> (step);
+    push (event);
+}
+
+
+void OSCEventSender::endBlock ()
+{
+    // nothing to send for blocks without events
+    if (! hasEvents) return;
+
+    push (Event());
+    hasEvents = false;
+
+    // wake the sender thread up, rather than it checking the queue all the time
+    notify();
+}
+
+
+void OSCEventSender::push (const Event& event)
+{
+    if (! isEnabled()) return;
+
+    // if the sender thread can't keep up, the events are dropped (rather than
+    // holding up the audio thread). Always leave room for the end of a block.
+    auto needed = event.type == Event::Type::endOfBlock ? 1 : 2;
+    if (fifo.getFreeSpace() < needed) return;
+
+    const auto scope = fifo.write (1);
+    if (scope.blockSize1 > 0)       queue[(size_t) scope.startIndex1] = event;
+    else if (scope.blockSize2 > 0)  queue[(size_t) scope.startIndex2] = event;
+
+    hasEvents = hasEvents || event.type != Event::Type::endOfBlock;
+}
+
+
+//==============================================================================
+
+
+void OSCEventSender::run()
+{
+    juce::OSCBundle bundle;
+
+    while (! threadShouldExit())
+    {
+        if (connectedPort != port) connect();
+
+        while (fifo.getNumReady() > 0)
+        {
+            Event event;
+            {
+                const auto scope = fifo.read (1);
+                event = scope.blockSize1 > 0 ? queue[(size_t) scope.startIndex1] : queue[(size_t) scope.startIndex2];
+            }
+
+            if (event.type == Event::Type::endOfBlock) {
+                send (bundle);
+                bundle = juce::OSCBundle();
+                continue;
+            }
+
+            // each event gets its own time tag, so receivers can play them at the right moment
+            juce::OSCBundle eventBundle (toTimeTag (event.timeMs));
+
+            if (event.type == Event::Type::step)
+                eventBundle.addElement (juce::OSCMessage ("/chancemachine/step", (int) event.step, event.on ? 1 : 0, (int) event.cycle));
+            else
+                eventBundle.addElement (juce::OSCMessage ("/chancemachine/trigger", (int) event.step));
+
+            bundle.addElement (eventBundle);
+        }
+
+        // woken up by endBlock() - the timeout is only for retrying the connection
+        wait (static_cast<int> (minRetryDelay));
+    }
+
+    sender.disconnect();
+    connectedPort = 0;
+    failedPort = 0;
+}
+
+
+void OSCEventSender::connect ()
+{
+    auto wantedPort = port.load();
+    auto now = juce::Time::getMillisecondCounter();
+
+    // a port that didn't work before isn't tried again straight away (a new one is)
+    if (wantedPort == failedPort && static_cast<juce::int32> (now - nextRetryTime) < 0)
+        return;
+
+    if (wantedPort != failedPort)
+        retryDelay = minRetryDelay;
+
+    sender.disconnect();
+    connectedPort = 0;
+
+    if (wantedPort > 0 && sender.connect ("127.0.0.1", wantedPort)) {
+        connectedPort = wantedPort;
+        failedPort = 0;
+        return;
+    }
+
+    failedPort = wantedPort;
+    nextRetryTime = now + retryDelay;
+    retryDelay = juce::jmin (retryDelay * 2, maxRetryDelay);
+}
+
+
+juce::OSCTimeTag OSCEventSender::toTimeTag (double timeMs)
+{
+    // NTP time: seconds since 1900 in the top 32 bits, the fraction of a second in the bottom 32
+    constexpr juce::uint64 secondsFrom1900To1970 = 2208988800ull;
+
+    auto seconds = std::floor (timeMs / 1000.0);
+    auto fraction = (timeMs - seconds * 1000.0) / 1000.0 * 4294967296.0;
+    auto fractionBits = static_cast<juce::uint64> (juce::jlimit (0.0, 4294967295.0, fraction));
+
+    return juce::OSCTimeTag (((static_cast<juce::uint64> (seconds) + secondsFrom1900To1970) << 32) | fractionBits);
+}
+
+
+void OSCEventSender::send (juce::OSCBundle& bundle)
+{
+    if (connectedPort > 0 && ! bundle.isEmpty())
+        sender.send (bundle);
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    OSCEventSender.h
+    Created: 19 Oct 2026 9:14:20am
+    Author:  Boris Divjak
+
+    Sends step and trigger events as OSC over UDP to a port on this
+    machine, for visualisers and lighting software. The audio thread only
+    puts events in a lock-free queue - a separate thread packs each
+    block's events into one bundle (with each event's own time tag) and
+    sends it. The thread sleeps until a block with events has ended.
+
+    Messages:
+        /chancemachine/step     step (int), on (int), cycle (int)
+        /chancemachine/trigger  step (int)
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class OSCEventSender  :  private juce::Thread
+{
+public:
+    OSCEventSender();
+    ~OSCEventSender() override;
+
+    // message thread. 0 switches the output off
+    void setPort (int newPort);
+    int getPort () const                { return port; }
+
+    // audio thread
+    bool isEnabled () const             { return port > 0; }
+    void addStep (double timeMs, int step, bool on, juce::int64 cycle);
+    void addTrigger (double timeMs, int step);
+    void endBlock ();
+
+    // OSC time tag for a time in milliseconds since 1970 (keeping fractions of a millisecond)
+    static juce::OSCTimeTag toTimeTag (double timeMs);
+
+private:
+    struct Event
+    {
+        enum class Type : juce::uint8 { step, trigger, endOfBlock };
+
+        Type type = Type::endOfBlock;
+        bool on = false;
+        juce::int16 step = 0;
+        juce::int32 cycle = 0;
+        double timeMs = 0;      // since 1970, like juce::Time
+    };
+
+    void push (const Event& event);
+    void run() override;
+    void connect ();
+    void send (juce::OSCBundle& bundle);
+
+    static constexpr int queueSize = 2048;
+    juce::AbstractFifo fifo { queueSize };
+    std::array<Event, queueSize> queue;
+    bool hasEvents = false;     // audio thread: anything added since the last endBlock()
+
+    std::atomic<int> port { 0 };
+    juce::OSCSender sender;
+
+    // sender thread only. If connecting fails, it's tried again later - waiting
+    // twice as long each time, up to maxRetryDelay
+    static constexpr juce::uint32 minRetryDelay = 100;     // ms
+    static constexpr juce::uint32 maxRetryDelay = 5000;
+    int connectedPort = 0;
+    int failedPort = 0;
+    juce::uint32 retryDelay = minRetryDelay;
+    juce::uint32 nextRetryTime = 0;
+};
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    PatternFile.h
+    Created: 19 Oct 2026 6:12:40pm
+    Author:  Boris Divjak
+
+    Reads a pattern from a saved plugin state, for the command line tools
+    that play patterns without the plugin (ChanceBatch, ChanceServer).
+
+    Pattern files are the plugin's own state, saved as XML (the PARAM
+    elements with chance0, condition0 etc., and any condition expressions).
+    The plugin writes one with 'Export pattern...' (right-click on the
+    background of the editor).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SequencerEngine.h"
+#include "ConditionExpression.h"
+#include "PatternOptions.h"
+
+//==============================================================================
+
+
+struct PatternFile
+{
+    using Engine = SequencerEngine<16>;
+
+    juce::File file;
+    Engine::Pattern pattern;
+
+    // returns false (and a reason in error) if the file can't be read, or one of its
+    // condition expressions doesn't make sense. A step length of '1 Bar' depends on
+    // the time signature, so that has to be given.
+    bool load (const juce::File& fileToLoad, double quarterNotesPerBar, juce::String& error)
+    {
+        auto xml = juce::XmlDocument::parse (fileToLoad);
+
+        if (xml == nullptr) {
+            error = "can't read " + fileToLoad.getFullPathName();
+            return false;
+        }
+
+        file = fileToLoad;
+        pattern = {};
+        auto dependency = Engine::Pattern::Dependency::none;
+        auto dependencyAmount = 0.0f;
+
+        for (auto* param : xml->getChildWithTagNameIterator ("PARAM")) {
+            auto id = param->getStringAttribute ("id");
+            auto value = param->getDoubleAttribute ("value");
+            auto index = juce::roundToInt (value);
+            auto step = id.getTrailingIntValue();
+
+            if (step >= 0 && step < Engine::numSteps && id.containsAnyOf ("0123456789")) {
+                auto& s = pattern.steps[0][(size_t) step];
+
+                if (id.startsWith ("chance"))
+                    s.chance = static_cast<float> (value);
+                else if (id.startsWith ("condition")) {
+                    auto& values = PatternOptions::condition_values;
+                    auto condition = values[(size_t) juce::jlimit (0, (int) values.size() - 1, index)];
+                    s.conditionA = static_cast<std::uint8_t> (condition.first);
+                    s.conditionB = static_cast<std::uint8_t> (condition.second);
+                }
+                else if (id.startsWith ("timing"))
+                    s.offset = static_cast<float> (value);
+                else if (id.startsWith ("ratchet"))
+                    s.ratchets = static_cast<std::uint8_t> (juce::jlimit (1, PatternOptions::ratchet_options.size(), index + 1));
+            }
+            else if (id == "swing")
+                pattern.swing = static_cast<float> (value);
+            else if (id == "dependency")
+                dependency = static_cast<Engine::Pattern::Dependency> (juce::jlimit (0, PatternOptions::dependency_options.size() - 1, index));
+            else if (id == "dependencyAmount")
+                dependencyAmount = static_cast<float> (value);
+            else if (id == "reset")
+                pattern.reset = juce::jlimit (1, PatternOptions::reset_options.size(), index + 1);
+            else if (id == "stepLength") {
+                auto& options = PatternOptions::stepLength_options;
+                auto length = PatternOptions::stepLength_values.at (options[juce::jlimit (0, options.size() - 1, index)]);
+                pattern.stepsPerQuarterNote = length == 1 ? 1.0 / quarterNotesPerBar : length / 4.0;
+            }
+        }
+
+        // once all the chances are known
+        pattern.setDependency (dependency, dependencyAmount);
+
+        // conditions typed in as expressions take the place of A:B
+        if (auto* conditions = xml->getChildByName ("Conditions")) {
+            for (auto step = 0; step < Engine::numSteps; ++step) {
+                auto text = conditions->getStringAttribute ("step" + juce::String (step));
+                std::string reason;
+
+                if (! ConditionExpression::compile (text.toStdString(), pattern.steps[0][(size_t) step].expression, reason)) {
+                    error = fileToLoad.getFileName() + ", step " + juce::String (step + 1) + ": " + reason;
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+};
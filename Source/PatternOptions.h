@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    PatternOptions.h
+    Created: 21 Oct 2026 9:48:13am
+    Author:  Boris Divjak
+
+    The options for the pattern parameters (trigger conditions, step length,
+    ratchets...) and what they stand for. The plugin and the command line
+    tools that read saved patterns (see PatternFile.h) both use these, so
+    they always agree on what an option index means. Only needs juce_core.
+
+    New options go at the end of a list - the parameters store the index.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include <vector>
+
+//==============================================================================
+
+
+struct PatternOptions
+{
+    static inline const juce::StringArray condition_options =
+        { "1:1", "1:2", "2:2", "1:4", "2:4", "3:4", "4:4",
+          "1:8", "2:8", "3:8", "4:8", "5:8", "6:8", "7:8", "8:8",
+          "1:16", "2:16", "3:16", "4:16", "5:16", "6:16", "7:16", "8:16",
+          "9:16", "10:16", "11:16", "12:16", "13:16", "14:16", "15:16", "16:16"};
+
+    static inline const juce::StringArray stepLength_options =
+        { "1 Bar", "1 / 2", "1 / 4", "1 / 8", "1 / 16" };
+    
+    // A and B for each of the condition options above (fire on the A-th out of every B cycles)
+    static inline const std::vector<std::pair<int, int>> condition_values = [] {
+        std::vector<std::pair<int, int>> values;
+        for (auto& c : condition_options) {
+            values.push_back ({ c.upToFirstOccurrenceOf (":", false, false).getIntValue(),
+                                c.fromFirstOccurrenceOf (":", false, false).getIntValue() });
+        }
+        return values;
+    }();
+
+    static inline const std::map<juce::String, int> stepLength_values =
+        { {"1 Bar", 1}, {"1 / 2", 2}, {"1 / 4", 4}, {"1 / 8", 8}, {"1 / 16", 16} };
+
+    // how many times each step is played (evenly spread across the step)
+    static inline const juce::StringArray ratchet_options =
+        { "x1", "x2", "x3", "x4", "x5", "x6", "x7", "x8" };
+
+    // what each step's chance depends on (see SequencerPattern::setDependency)
+    static inline const juce::StringArray dependency_options =
+        { "Independent", "Previous step", "Step + cycle" };
+
+    static inline const juce::StringArray reset_options =
+        { "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15", "16"};
+};
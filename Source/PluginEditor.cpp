@@ -17,7 +17,7 @@
 ChanceMachineAudioProcessorEditor::ChanceMachineAudioProcessorEditor (ChanceMachineAudioProcessor& p)
 : AudioProcessorEditor (&p), audioProcessor (p),
 state (p.state),
-midiSelect (p.midiSelect)
+midiSelect (p.midiRouter, *p.state.getParameter ("midiSelect"))
 
 {
     // set the colour scheme for highlights
@@ -32,7 +32,7 @@ midiSelect (p.midiSelect)
     int num_sliders = 16;
     
     for (int i=0; i<num_sliders; i++) {
-        juce::Slider * stepChance = new juce::Slider;
+        auto * stepChance = new RightClickableSlider;
         stepChance->setSliderStyle(juce::Slider::LinearBarVertical);
         stepChance->setTextBoxStyle(juce::Slider::NoTextBox, false, 90, 0);
         addAndMakeVisible (*stepChance);
@@ -51,72 +51,116 @@ midiSelect (p.midiSelect)
     addLabelAndSetStyle (conditionsLabel);
 
     for (int i=0; i<num_sliders; i++) {
-        juce::ComboBox * stepCondition = new juce::ComboBox;
-        stepCondition->addItemList(audioProcessor.condition_options, 1);
-        addAndMakeVisible (*stepCondition);
-        stepConditions.add(stepCondition);
-        stepCondition->setLookAndFeel(&comboBoxSmallerFont);
-        
-        juce::AudioProcessorValueTreeState::ComboBoxAttachment * condAttach =
-            new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.state, "condition" + std::to_string(i), *stepCondition);
-        stepConditionsAttach.add(condAttach);
+        auto stepCondition = stepConditions.add(new LazyChoiceBox);
+        addChoiceBox (*stepCondition, "condition" + std::to_string(i), audioProcessor.condition_options);
+
+        // conditions can also be typed in as expressions, e.g. "!1:4" or "prev & 1:2"
+        stepCondition->setEditableText (true);
+        stepCondition->setCustomText (audioProcessor.getConditionExpression (i));
+
+        stepCondition->onCustomText = [this, i, stepCondition] (const juce::String& text) {
+            juce::String error;
+            if (! audioProcessor.setConditionExpression (i, text, error)) {
+                audioProcessor.statusMessage = ("Step " + juce::String (i+1) + ": " + error).toStdString();
+            }
+            stepCondition->setCustomText (audioProcessor.getConditionExpression (i));
+        };
+
+        // picking one from the list goes back to plain A:B
+        stepCondition->onOptionPicked = [this, i, stepCondition] {
+            juce::String error;
+            audioProcessor.setConditionExpression (i, {}, error);
+            stepCondition->setCustomText ({});
+        };
     }
 
+    // steps can depend on the ones before them - pick what on, and how much (negative is less likely after a hit)
+    addChoiceBox (dependencySelect, "dependency", audioProcessor.dependency_options);
+
+    dependencySlider.setSliderStyle(juce::Slider::LinearBar);
+    dependencySlider.setTextValueSuffix(" %");
+    dependencySlider.setDoubleClickReturnValue(true, 0.0);
+    addAndMakeVisible (dependencySlider);
+    dependencyAttach = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(p.state, "dependencyAmount", dependencySlider);
+
+    addAndMakeVisible (fillButton);
+    fillAttach = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(p.state, "fill", fillButton);
+
+
+    // TIMING ROW ----------
+
+    addLabelAndSetStyle (timingLabel);
+
+    for (int i=0; i<num_sliders; i++) {
+        juce::Slider * stepTiming = new juce::Slider;
+        stepTiming->setSliderStyle(juce::Slider::LinearBar);
+        stepTiming->setTextBoxStyle(juce::Slider::NoTextBox, false, 90, 0);
+        stepTiming->setDoubleClickReturnValue(true, 0.0);
+        addAndMakeVisible (*stepTiming);
+        stepTimings.add(stepTiming);
+
+        juce::AudioProcessorValueTreeState::SliderAttachment * timingAttach =
+            new juce::AudioProcessorValueTreeState::SliderAttachment(p.state, "timing" + std::to_string(i), *stepTiming);
+        stepTimingsAttach.add(timingAttach);
+
+        auto stepRatchet = stepRatchets.add(new LazyChoiceBox);
+        addChoiceBox (*stepRatchet, "ratchet" + std::to_string(i), audioProcessor.ratchet_options);
+    }
+
+    // send steps as OSC to a port on this computer (type a port number, or nothing to switch it off)
+    addLabelAndSetStyle (oscLabel);
+    addLabelAndSetStyle (oscPortLabel);
+    oscPortLabel.setEditable (true);
+    oscPortLabel.setText (audioProcessor.getOscPort() > 0 ? juce::String (audioProcessor.getOscPort()) : "off", juce::dontSendNotification);
+    oscPortLabel.onTextChange = [this] {
+        audioProcessor.setOscPort (oscPortLabel.getText().getIntValue());
+        oscPortLabel.setText (audioProcessor.getOscPort() > 0 ? juce::String (audioProcessor.getOscPort()) : "off", juce::dontSendNotification);
+    };
+
+    // swing delays every other step
+    addLabelAndSetStyle (swingLabel);
+
+    swingSlider.setSliderStyle(juce::Slider::LinearBar);
+    swingSlider.setTextValueSuffix(" %");
+    swingSlider.setDoubleClickReturnValue(true, 0.0);
+    addAndMakeVisible (swingSlider);
+    swingAttach = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(p.state, "swing", swingSlider);
+
 
     // THIRD ROW ----------
     
     // create the combobox to select step length
     addLabelAndSetStyle (stepLengthLabel);
 
-    stepLengthSelect.addItemList(audioProcessor.stepLength_options, 1);
-    addAndMakeVisible (stepLengthSelect);
-    auto stepLengthAttach = new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.state, "stepLength", stepLengthSelect);
-    comboAttachments.add(stepLengthAttach);
-    stepLengthSelect.setLookAndFeel(&comboBoxSmallerFont);
+    addChoiceBox (stepLengthSelect, "stepLength", audioProcessor.stepLength_options);
 
     
     // create the combobox to select when to reset
     addLabelAndSetStyle (resetLabel);
 
-    resetSelect.addItemList(audioProcessor.reset_options, 1);
-    addAndMakeVisible (resetSelect);
-    resetSelect.setLookAndFeel(&comboBoxSmallerFont);
+    addChoiceBox (resetSelect, "reset", audioProcessor.reset_options);
+
+    // create the combobox to select when pattern changes take effect
+    addLabelAndSetStyle (patternSyncLabel);
 
-    auto resetAttach = new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.state, "reset", resetSelect);
-    comboAttachments.add(resetAttach);
+    addChoiceBox (patternSyncSelect, "patternSync", audioProcessor.patternSync_options);
 
     // create the combobox to select what kind of message to send to midi out
     addLabelAndSetStyle (sendOutLabel);
 
-    sendOutSelect.addItem("Forward host note", 1);
-    sendOutSelect.addItem("CC", 2);
-    sendOutSelect.addItem("CC inverted", 3);
-    sendOutSelect.setSelectedId(1);
-    addAndMakeVisible (sendOutSelect);
-    sendOutSelect.setLookAndFeel(&comboBoxSmallerFont);
-
-    auto sendOutAttach = new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.state, "sendOut", sendOutSelect);
-    comboAttachments.add(sendOutAttach);
+    addChoiceBox (sendOutSelect, "sendOut", sendOut_names);
 
     
     // create the combobox to select which CC to send (when sending CC)
     addLabelAndSetStyle (CCLabel);
 
-    for (auto i=0; i<=127; i++) {
-        CCSelect.addItem(std::to_string(i), i+1);
-    }
-    CCSelect.setSelectedId(1);
-    addAndMakeVisible (CCSelect);
-    CCSelect.setLookAndFeel(&comboBoxSmallerFont);
-    
-    auto CCAttach = new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.state, "CC", CCSelect);
-    comboAttachments.add(CCAttach);
+    addChoiceBox (CCSelect, "CC", CC_numbers);
     
     
     // disable CC ComboBox when not relevant
     sendOutSelect.onChange = [this] {
-        auto i = sendOutSelect.getSelectedId();
-        if (i>1) {
+        auto i = sendOutSelect.getSelectedOption();
+        if (i>0) {
             CCLabel.setEnabled(true);
             CCSelect.setEnabled(true);
         }
@@ -137,14 +181,7 @@ midiSelect (p.midiSelect)
     // create the combobox to select MIDI channel to use
     addLabelAndSetStyle (channelLabel);
 
-    for (auto i=1; i<=16; i++) {
-        channelSelect.addItem(std::to_string(i), i+1);
-    }
-    addAndMakeVisible (channelSelect);
-    channelSelect.setLookAndFeel(&comboBoxSmallerFont);
-    
-    auto channelAttach = new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.state, "channel", channelSelect);
-    comboAttachments.add(channelAttach);
+    addChoiceBox (channelSelect, "channel", audioProcessor.channel_options);
     
 
     
@@ -152,10 +189,72 @@ midiSelect (p.midiSelect)
     addLabelAndSetStyle (statusLabel);
 
 
+    // listen to the notes coming in, then set the chances (and conditions) to match
+    learnButton.setToggleState(audioProcessor.stepLearner.isLearning(), juce::dontSendNotification);
+    learnButton.onClick = [this] {
+        audioProcessor.stepLearner.setLearning(learnButton.getToggleState());
+    };
+    addAndMakeVisible (learnButton);
+
+    applyLearnedButton.onClick = [this] {
+        audioProcessor.applyLearnedPattern();
+    };
+    addAndMakeVisible (applyLearnedButton);
+
+
+    // pick a pattern from the bank (same as a program change)
+    programSelect.setOptions (audioProcessor.program_options);
+    addAndMakeVisible (programSelect);
+    programSelect.setLookAndFeel(&comboBoxSmallerFont);
+    programSelect.onOptionPicked = [this] {
+        audioProcessor.setCurrentProgram(programSelect.getSelectedOption());
+    };
+
+
+    // send MIDI clock to the host and the selected MIDI output
+    addAndMakeVisible (clockOutButton);
+    clockOutAttach = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(p.state, "clockOut", clockOutButton);
+
+
+    // transport controls for the standalone app (plugins follow the host instead)
+    showTransport = p.state.getParameter ("play") != nullptr;
+
+    // in plugins, notes can also go to other programs through shared memory (the standalone
+    // app can send to any MIDI device directly, and needs the space for its transport)
+    if (! showTransport) {
+        addAndMakeVisible (sharedOutButton);
+        sharedOutButton.onClick = [this] {
+            audioProcessor.midiRouter.setSharedOutput (sharedOutButton.getToggleState());
+            updateSharedOutButton();
+        };
+        updateSharedOutButton();
+    }
+
+    if (showTransport) {
+        addAndMakeVisible (playButton);
+        playAttach = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(p.state, "play", playButton);
+
+        tempoSlider.setSliderStyle(juce::Slider::LinearBar);
+        tempoSlider.setTextValueSuffix(" BPM");
+        addAndMakeVisible (tempoSlider);
+        tempoAttach = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(p.state, "tempo", tempoSlider);
+
+        addChoiceBox (timeSignatureSelect, "timeSignature", audioProcessor.timeSignature_options);
+    }
+
+
     
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (830, 370);
+    setSize (830, 480);
+
+    // chances, conditions, step length and reset can be MIDI learned
+    for (int i=0; i<num_sliders; i++) {
+        addMidiLearn (*stepChances[i], "chance" + std::to_string(i));
+        addMidiLearn (*stepConditions[i], "condition" + std::to_string(i));
+    }
+    addMidiLearn (stepLengthSelect, "stepLength");
+    addMidiLearn (resetSelect, "reset");
 
     // start refresh timer
     startTimer (100);
@@ -176,16 +275,19 @@ ChanceMachineAudioProcessorEditor::~ChanceMachineAudioProcessorEditor()
     for (int i=0; i<num_sliders; i++) {
         stepChances[i]->setLookAndFeel(nullptr);
         stepConditions[i]->setLookAndFeel(nullptr);
+        stepRatchets[i]->setLookAndFeel(nullptr);
     }
 
     stepLengthSelect.setLookAndFeel(nullptr);
     resetSelect.setLookAndFeel(nullptr);
+    patternSyncSelect.setLookAndFeel(nullptr);
     sendOutSelect.setLookAndFeel(nullptr);
     CCSelect.setLookAndFeel(nullptr);
     midiSelect.setLookAndFeel(nullptr);
     channelSelect.setLookAndFeel(nullptr);
-    
-    midiSelect.setVisible(false);
+    timeSignatureSelect.setLookAndFeel(nullptr);
+    programSelect.setLookAndFeel(nullptr);
+    dependencySelect.setLookAndFeel(nullptr);
 }
 
 
@@ -205,7 +307,36 @@ void ChanceMachineAudioProcessorEditor::changeListenerCallback(juce::ChangeBroad
 
 void ChanceMachineAudioProcessorEditor::timerCallback()
 {
+    auto droppedEvents = audioProcessor.getNumDroppedEvents();
+    if (droppedEvents != lastDroppedEvents) {
+        lastDroppedEvents = droppedEvents;
+        audioProcessor.statusMessage = std::to_string (droppedEvents) + " events dropped, too much going on at once";
+    }
+
     statusLabel.setText(audioProcessor.statusMessage, juce::dontSendNotification);
+    programSelect.setSelectedOption(audioProcessor.getCurrentProgram());
+    if (! showTransport) updateSharedOutButton();
+
+    // say which controller MIDI learn picked up
+    if (midiLearnParameter.isNotEmpty() && audioProcessor.midiLearn.getLearningParameter() != midiLearnParameter) {
+        auto mapping = audioProcessor.midiLearn.getMappingText (midiLearnParameter);
+
+        auto* param = state.getParameter (midiLearnParameter);
+
+        if (param != nullptr && mapping.isNotEmpty())
+            audioProcessor.statusMessage = (param->getName (32) + " follows " + mapping).toStdString();
+
+        midiLearnParameter = {};
+    }
+}
+
+
+void ChanceMachineAudioProcessorEditor::updateSharedOutButton()
+{
+    // show which ring we ended up with, so readers know where to look
+    auto ring = audioProcessor.midiRouter.getSharedRingNumber();
+    sharedOutButton.setToggleState (ring > 0, juce::dontSendNotification);
+    sharedOutButton.setButtonText (ring > 0 ? "Share: " + juce::String (ring) : "Share");
 }
 
 
@@ -217,6 +348,8 @@ void ChanceMachineAudioProcessorEditor::timerCallback()
 void ChanceMachineAudioProcessorEditor::paint (juce::Graphics& g)
 
 {
+    TraceRecorder::Scope trace ("editor paint");
+
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 
@@ -225,6 +358,130 @@ void ChanceMachineAudioProcessorEditor::paint (juce::Graphics& g)
 //    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
 }
 
+
+void ChanceMachineAudioProcessorEditor::mouseDown (const juce::MouseEvent& event)
+{
+    if (! event.mods.isPopupMenu()) return;
+
+    // right-click on a control that can be MIDI learned
+    for (auto* component = event.originalComponent; component != nullptr && component != this;
+         component = component->getParentComponent()) {
+        auto paramID = component->getProperties()["midiLearn"].toString();
+
+        if (paramID.isNotEmpty()) {
+            showMidiLearnMenu (paramID);
+            return;
+        }
+    }
+
+    // right-click on the background for recording takes and traces, and exporting the pattern
+
+    auto& tracer = TraceRecorder::getInstance();
+    auto& recorder = audioProcessor.takeRecorder;
+
+    juce::PopupMenu menu;
+    menu.addItem ("Record take", ! recorder.isRecording(), false, [&recorder] {
+        // takes are kept in the app data folder, even if they're never exported
+        recorder.start (juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                            .getChildFile ("ChanceMachine").getChildFile ("Takes")
+                            .getNonexistentChildFile ("Take " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H%M%S"), ".mid"));
+    });
+    menu.addItem ("Stop and export take...", recorder.isRecording(), false, [this] { exportTake(); });
+    menu.addSeparator();
+    menu.addItem ("Export pattern...", [this] { exportPattern(); });
+    menu.addSeparator();
+    menu.addItem ("Record trace", ! tracer.isRecording(), false, [&tracer] { tracer.start(); });
+    menu.addItem ("Save trace to desktop", tracer.isRecording(), false, [&processor = audioProcessor, &tracer] {
+        auto file = juce::File::getSpecialLocation (juce::File::userDesktopDirectory)
+                        .getNonexistentChildFile ("ChanceMachine trace", ".json");
+
+        processor.statusMessage = tracer.writeTo (file) ? "Saved " + file.getFileName().toStdString()
+                                                             : "Couldn't save the trace";
+    });
+
+    menu.showMenuAsync (juce::PopupMenu::Options().withTargetComponent (this).withMousePosition());
+}
+
+void ChanceMachineAudioProcessorEditor::addMidiLearn (juce::Component& component, const juce::String& paramID)
+{
+    // the editor hears right-clicks on the control (and its text box), and knows which parameter it's for
+    component.getProperties().set ("midiLearn", paramID);
+    component.addMouseListener (this, true);
+}
+
+
+void ChanceMachineAudioProcessorEditor::showMidiLearnMenu (const juce::String& paramID)
+{
+    auto* param = state.getParameter (paramID);
+    if (param == nullptr) return;
+
+    auto& midiLearn = audioProcessor.midiLearn;
+    auto mapping = midiLearn.getMappingText (paramID);
+
+    juce::PopupMenu menu;
+    menu.addSectionHeader (param->getName (32) + (mapping.isNotEmpty() ? " (" + mapping + ")" : ""));
+
+    if (midiLearn.getLearningParameter() == paramID) {
+        menu.addItem ("Cancel MIDI learn", [&midiLearn] { midiLearn.stopLearning(); });
+    }
+    else {
+        // the menu can outlive the editor
+        auto editor = juce::Component::SafePointer<ChanceMachineAudioProcessorEditor> (this);
+        menu.addItem ("MIDI learn", [editor, paramID] { if (editor != nullptr) editor->startMidiLearn (paramID); });
+    }
+
+    menu.addItem ("Forget MIDI CC", mapping.isNotEmpty(), false, [&midiLearn, paramID] { midiLearn.forget (paramID); });
+
+    menu.showMenuAsync (juce::PopupMenu::Options().withMousePosition());
+}
+
+
+void ChanceMachineAudioProcessorEditor::startMidiLearn (const juce::String& paramID)
+{
+    audioProcessor.midiLearn.startLearning (paramID);
+    midiLearnParameter = paramID;
+
+    if (auto* param = state.getParameter (paramID))
+        audioProcessor.statusMessage = ("Move a MIDI controller for " + param->getName (32)).toStdString();
+}
+
+
+void ChanceMachineAudioProcessorEditor::exportTake()
+{
+    auto take = audioProcessor.takeRecorder.stop();
+    if (! take.existsAsFile()) return;
+
+    takeChooser = std::make_unique<juce::FileChooser> ("Export take", juce::File::getSpecialLocation (juce::File::userDesktopDirectory)
+                                                                        .getChildFile (take.getFileName()), "*.mid");
+
+    auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    takeChooser->launchAsync (flags, [take] (const juce::FileChooser& chooser) {
+        auto destination = chooser.getResult();
+        if (destination != juce::File()) take.copyFileTo (destination.withFileExtension (".mid"));
+    });
+}
+
+
+void ChanceMachineAudioProcessorEditor::exportPattern()
+{
+    patternChooser = std::make_unique<juce::FileChooser> ("Export pattern", juce::File::getSpecialLocation (juce::File::userDesktopDirectory)
+                                                                              .getChildFile ("Pattern " + juce::String (audioProcessor.getCurrentProgram() + 1) + ".xml"), "*.xml");
+
+    auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    // the chooser belongs to the editor, so it's gone before the editor is
+    patternChooser->launchAsync (flags, [this] (const juce::FileChooser& chooser) {
+        auto destination = chooser.getResult();
+        if (destination == juce::File()) return;
+
+        destination = destination.withFileExtension (".xml");
+        audioProcessor.statusMessage = audioProcessor.exportPattern (destination) ? "Saved " + destination.getFileName().toStdString()
+                                                                                  : "Couldn't save the pattern";
+    });
+}
+
+
 void ChanceMachineAudioProcessorEditor::resized()
 {
     // This is generally where you'll want to lay out the positions of any
@@ -237,13 +494,16 @@ void ChanceMachineAudioProcessorEditor::resized()
     auto num_cols = 16;
     auto col = (getWidth() - (2 * margin_out) - ((num_cols - 1) * margin)) / num_cols;
     auto num_rows = 8;
-    auto row = (getHeight() - (2 * margin_out) - ((num_rows - 1) * margin_v)) / num_rows;
+
+    // the timing row has a fixed height, the other rows share what's left
+    auto timing_row_height = 80;
+    auto row = (getHeight() - timing_row_height - margin_v - (2 * margin_out) - ((num_rows - 1) * margin_v)) / num_rows;
 
     auto first_row_height = row * 4 + 3 * margin_v;
     auto second_row_height = row * 2 + 1 * margin_v;
-    auto third_row_height = row * 2 + 1 * margin_v;
     auto second_row_y = first_row_height + margin_out + margin_v;
-    auto third_row_y = first_row_height + second_row_height + margin_out + 2*margin_v;
+    auto timing_row_y = first_row_height + second_row_height + margin_out + 2*margin_v;
+    auto third_row_y = timing_row_y + timing_row_height + margin_v;
 
     
     // FIRST ROW ---------------------------------------------
@@ -269,6 +529,21 @@ void ChanceMachineAudioProcessorEditor::resized()
                                 20 );                           // height
 
 
+    dependencySelect.setBounds ( margin_out + col*8 + margin*8,
+                                second_row_y - 2,
+                                col * 3 + margin * 2,
+                                22 );
+
+    dependencySlider.setBounds ( margin_out + col*11 + margin*11,
+                                second_row_y,
+                                col * 3 + margin * 2,
+                                20 );
+
+    fillButton.setBounds (      margin_out + col*14 + margin*14,
+                                second_row_y,
+                                col * 2 + margin,
+                                20 );
+
     for (int i=0; i<stepConditions.size(); i++) {
         stepConditions.getUnchecked(i)->setBounds (margin_out + i*col + i*margin,  // x
                                                    second_row_y + 28,              // y
@@ -277,7 +552,47 @@ void ChanceMachineAudioProcessorEditor::resized()
     }
 
 
-    
+
+    // TIMING ROW ---------------------------------------------
+
+    timingLabel.setBounds (     margin_out,                     // x
+                                timing_row_y,                   // y
+                                col * 8 + margin * 7,           // width
+                                20 );                           // height
+
+    oscLabel.setBounds (        margin_out + col*8 + margin*8,
+                                timing_row_y,
+                                col * 2 + margin,
+                                20 );
+
+    oscPortLabel.setBounds (    margin_out + col*10 + margin*10,
+                                timing_row_y,
+                                col,
+                                20 );
+
+    swingLabel.setBounds (      margin_out + col*11 + margin*11,
+                                timing_row_y,
+                                col,
+                                20 );
+
+    swingSlider.setBounds (     margin_out + col*12 + margin*12,
+                                timing_row_y,
+                                col * 4 + margin * 3,
+                                20 );
+
+    for (int i=0; i<stepTimings.size(); i++) {
+        stepTimings.getUnchecked(i)->setBounds (margin_out + i*col + i*margin,  // x
+                                                timing_row_y + 28,              // y
+                                                col,                            // width
+                                                20);                            // height
+
+        stepRatchets.getUnchecked(i)->setBounds (margin_out + i*col + i*margin,
+                                                 timing_row_y + 56,
+                                                 col,
+                                                 24);
+    }
+
+
     // THIRD ROW ---------------------------------------------
     
     stepLengthLabel.setBounds ( margin_out,                     // x
@@ -302,6 +617,16 @@ void ChanceMachineAudioProcessorEditor::resized()
                                 col * 3 + margin * 2,
                                 24 );
 
+    patternSyncLabel.setBounds ( margin_out + col*6 + margin*6,  // x
+                                third_row_y,                   // y
+                                col * 2 + margin,               // width
+                                20 );                           // height
+
+    patternSyncSelect.setBounds ( margin_out + col*6 + margin*6,
+                                third_row_y + 28,
+                                col * 2 + margin,
+                                24 );
+
     sendOutLabel.setBounds (    margin_out + col*8 + margin*8,  // x
                                 third_row_y,                   // y
                                 col * 4 + margin * 3,           // width
@@ -346,9 +671,51 @@ void ChanceMachineAudioProcessorEditor::resized()
 
     statusLabel.setBounds (       margin_out,
                                 getHeight() - 2*margin,
-                                col*16 + margin*15,
+                                col*2 + margin,
                                 20);
 
+    learnButton.setBounds (     margin_out + col*2 + margin*2,
+                                getHeight() - 2*margin,
+                                col * 2 + margin,
+                                20 );
+
+    applyLearnedButton.setBounds ( margin_out + col*4 + margin*4,
+                                getHeight() - 2*margin,
+                                col * 2 + margin,
+                                20 );
+
+    programSelect.setBounds (   margin_out + col*6 + margin*6,
+                                getHeight() - 2*margin,
+                                col * 2 + margin,
+                                20 );
+
+    clockOutButton.setBounds (  margin_out + col*8 + margin*8,
+                                getHeight() - 2*margin,
+                                col * 2 + margin,
+                                20 );
+
+    sharedOutButton.setBounds ( margin_out + col*10 + margin*10,
+                                getHeight() - 2*margin,
+                                col * 2 + margin,
+                                20 );
+
+    if (showTransport) {
+        playButton.setBounds (      margin_out + col*10 + margin*10,
+                                    getHeight() - 2*margin,
+                                    col,
+                                    20 );
+
+        tempoSlider.setBounds (     margin_out + col*11 + margin*11,
+                                    getHeight() - 2*margin,
+                                    col * 3 + margin * 2,
+                                    20 );
+
+        timeSignatureSelect.setBounds ( margin_out + col*14 + margin*14,
+                                        getHeight() - 2*margin,
+                                        col * 2 + margin,
+                                        20 );
+    }
+
 
 }
 
@@ -356,6 +723,18 @@ void ChanceMachineAudioProcessorEditor::resized()
 //==============================================================================
 
 
+void ChanceMachineAudioProcessorEditor::addChoiceBox (LazyChoiceBox& box, const juce::String& paramID, const juce::StringArray& options)
+
+{
+    // the items are only filled in when the box is first clicked
+    if (auto* param = state.getParameter (paramID))
+        box.attachTo (*param, options);
+
+    addAndMakeVisible (box);
+    box.setLookAndFeel (&comboBoxSmallerFont);
+}
+
+
 void ChanceMachineAudioProcessorEditor::addLabelAndSetStyle (juce::Label& label)
 
 {
@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "MIDIOutSelector.h"
+#include "LazyChoiceBox.h"
 #include "PluginProcessor.h"
 
 //==============================================================================
@@ -26,6 +27,17 @@ class ComboBoxSmallerFont  :  public juce::LookAndFeel_V4
 };
 
 
+// a slider that can be right-clicked (for the MIDI learn menu) without moving it.
+// The editor still gets the click, as it listens to the slider's mouse events.
+class RightClickableSlider  :  public juce::Slider
+{
+public:
+    void mouseDown (const juce::MouseEvent& e) override    { if (! e.mods.isPopupMenu()) juce::Slider::mouseDown (e); }
+    void mouseDrag (const juce::MouseEvent& e) override    { if (! e.mods.isPopupMenu()) juce::Slider::mouseDrag (e); }
+    void mouseUp (const juce::MouseEvent& e) override      { if (! e.mods.isPopupMenu()) juce::Slider::mouseUp (e); }
+};
+
+
 
 class ChanceMachineAudioProcessorEditor  :  public juce::AudioProcessorEditor,
                                         public juce::ChangeListener,
@@ -40,12 +52,31 @@ public:
     //==============================================================================
     void paint (juce::Graphics&) override;
     void resized() override;
+    void mouseDown (const juce::MouseEvent&) override;
+    void exportTake ();
+    void exportPattern ();
     
 private:
     void changeListenerCallback (juce::ChangeBroadcaster *source) override;
     void timerCallback() override;
     void valueChanged (juce::Value&) override;
     void addLabelAndSetStyle (juce::Label& label);
+    void addChoiceBox (LazyChoiceBox& box, const juce::String& paramID, const juce::StringArray& options);
+
+    // right-click on these to map them to a MIDI controller
+    void addMidiLearn (juce::Component& component, const juce::String& paramID);
+    void showMidiLearnMenu (const juce::String& paramID);
+    void startMidiLearn (const juce::String& paramID);
+    juce::String midiLearnParameter;        // waiting for a controller, so the status can say when it's found
+
+    // names shown in the editor where they're different from the parameter's own
+    static inline const juce::StringArray sendOut_names = { "Forward host note", "CC", "CC inverted" };
+
+    static inline const juce::StringArray CC_numbers = [] {
+        juce::StringArray numbers;
+        for (auto i=0; i<=127; i++) numbers.add(std::to_string(i));
+        return numbers;
+    }();
 
     
     // This reference is provided as a quick way for your editor to
@@ -56,40 +87,88 @@ private:
 
     // first row components
     juce::Label chanceLabel       { "Chance Label", "Probability per step:" };
-    juce::OwnedArray<juce::Slider> stepChances;
+    juce::OwnedArray<RightClickableSlider> stepChances;
     juce::OwnedArray<juce::AudioProcessorValueTreeState::SliderAttachment> stepChancesAttach;
 
     
     // second row components
     juce::Label conditionsLabel       { "Conditions Label", "Trigger conditions (every A out of B cycles):" };
-    juce::OwnedArray<juce::ComboBox> stepConditions;
-    juce::OwnedArray<juce::AudioProcessorValueTreeState::ComboBoxAttachment> stepConditionsAttach;
+    juce::OwnedArray<LazyChoiceBox> stepConditions;
+
+    LazyChoiceBox dependencySelect;
+    juce::Slider dependencySlider;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> dependencyAttach;
+
+    juce::ToggleButton fillButton   { "Fill" };
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> fillAttach;
+
+
+    // timing row components
+    juce::Label timingLabel       { "Timing Label", "Timing (early / late) and ratchets per step:" };
+    juce::OwnedArray<juce::Slider> stepTimings;
+    juce::OwnedArray<juce::AudioProcessorValueTreeState::SliderAttachment> stepTimingsAttach;
+    juce::OwnedArray<LazyChoiceBox> stepRatchets;
+
+    juce::Label oscLabel   { "OSC Label", "OSC port:" };
+    juce::Label oscPortLabel   { "OSC Port", "off" };
+
+    juce::Label swingLabel   { "Swing Label", "Swing:" };
+    juce::Slider swingSlider;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> swingAttach;
 
 
     // third row components
     juce::Label stepLengthLabel   { "Step Length Label", "Step length:" };
-    juce::ComboBox stepLengthSelect;
+    LazyChoiceBox stepLengthSelect;
     juce::Label resetLabel   { "Reset Label", "Reset after:" };
-    juce::ComboBox resetSelect;
+    LazyChoiceBox resetSelect;
+    juce::Label patternSyncLabel   { "Pattern Sync Label", "Changes at:" };
+    LazyChoiceBox patternSyncSelect;
 
     juce::Label sendOutLabel   { "Send Label", "Message to send:" };
-    juce::ComboBox sendOutSelect;
+    LazyChoiceBox sendOutSelect;
 
     juce::Label CCLabel   { "CC Label", "CC:" };
-    juce::ComboBox CCSelect;
+    LazyChoiceBox CCSelect;
 
     juce::Label midiOutputLabel   { "Midi Output Label", "MIDI Output:" };
-    MIDIOutSelector& midiSelect;
+    MIDIOutSelector midiSelect;
 
     juce::Label channelLabel   { "Channel Label", "Ch:" };
-    juce::ComboBox channelSelect;
+    LazyChoiceBox channelSelect;
 
+    int lastDroppedEvents = 0;
     juce::Label statusLabel         { "Test Label", "" };
 
-    
-    juce::OwnedArray<juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachments;
+    LazyChoiceBox programSelect;
+
+    // learn chances from the notes coming in
+    juce::ToggleButton learnButton   { "Learn" };
+    juce::TextButton applyLearnedButton   { "Apply" };
+
+    // publish to a shared memory ring (for programs that read it instead of a virtual MIDI device)
+    juce::ToggleButton sharedOutButton   { "Share" };
+    void updateSharedOutButton ();
+
+    juce::ToggleButton clockOutButton   { "Send clock" };
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> clockOutAttach;
+
+    // transport controls, only shown in the standalone app
+    bool showTransport = false;
+    juce::ToggleButton playButton   { "Play" };
+    juce::Slider tempoSlider;
+    LazyChoiceBox timeSignatureSelect;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> playAttach;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> tempoAttach;
+
 
     
+    // where a recorded take is exported to
+    std::unique_ptr<juce::FileChooser> takeChooser;
+
+    // ...and the pattern, for the command line tools
+    std::unique_ptr<juce::FileChooser> patternChooser;
+
     juce::LookAndFeel_V4 basicLook;
     juce::LookAndFeel_V4 highlightedLook;
     ComboBoxSmallerFont comboBoxSmallerFont;
@@ -19,7 +19,32 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include <random>
+
+
+//==============================================================================
+// One timer for all instances, which picks up pattern changes, program
+// changes and MIDI learned CCs on the message thread (rather than every
+// instance waking it up on its own). An instance with nothing waiting costs
+// a few atomic loads.
+
+class ChanceMachineAudioProcessor::ChangePoller  :  private juce::Timer
+{
+public:
+    ChangePoller ()             { startTimer (10); }
+    ~ChangePoller () override   { stopTimer(); }
+
+    void add (ChanceMachineAudioProcessor* processor)       { processors.add (processor); }
+    void remove (ChanceMachineAudioProcessor* processor)    { processors.remove (processor); }
+
+private:
+    void timerCallback() override
+    {
+        processors.call ([] (ChanceMachineAudioProcessor& p) { p.pollChanges(); });
+    }
+
+    juce::ListenerList<ChanceMachineAudioProcessor> processors;
+};
+
 
 std::string ChanceMachineAudioProcessor::extracted(int i) {
     auto display_name = "Chance " + std::to_string(i+1);
@@ -32,11 +57,82 @@ ChanceMachineAudioProcessor::ChanceMachineAudioProcessor()
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                        ),
-        state (*this, nullptr),
-        midiSelect("MIDI Out", *this)
+        state (*this, nullptr, "ChancePlugin", createParameterLayout()),
+        midiRouter(*this)
+
+
+{
+    // NB: MIDI devices are not enumerated here - the MIDI router does that
+    // asynchronously on the message thread, so hosts loading lots of
+    // instances don't have to wait for it
+
+    // keep pointers to the raw parameter values, so the audio thread doesn't have to look them up
+    for (int i=0; i<numSteps; i++) {
+        chanceValues[(size_t) i] = state.getRawParameterValue ("chance" + std::to_string(i));
+        conditionValues[(size_t) i] = state.getRawParameterValue ("condition" + std::to_string(i));
+        timingValues[(size_t) i] = state.getRawParameterValue ("timing" + std::to_string(i));
+        ratchetValues[(size_t) i] = state.getRawParameterValue ("ratchet" + std::to_string(i));
+    }
+    swingValue = state.getRawParameterValue ("swing");
+    dependencyValue = state.getRawParameterValue ("dependency");
+    dependencyAmountValue = state.getRawParameterValue ("dependencyAmount");
+    fillValue = state.getRawParameterValue ("fill");
+    patternSyncValue = state.getRawParameterValue ("patternSync");
+    stepLengthValue = state.getRawParameterValue ("stepLength");
+    resetValue = state.getRawParameterValue ("reset");
+    sendOutValue = state.getRawParameterValue ("sendOut");
+    CCValue = state.getRawParameterValue ("CC");
+    channelValue = state.getRawParameterValue ("channel");
+    midiRateValue = state.getRawParameterValue ("midiRate");
+    clockOutValue = state.getRawParameterValue ("clockOut");
+
+    // these only exist in the standalone app
+    playValue = state.getRawParameterValue ("play");
+    tempoValue = state.getRawParameterValue ("tempo");
+    timeSignatureValue = state.getRawParameterValue ("timeSignature");
+
+    state.state.setProperty ("version", "0.2i", nullptr);
+
+    // store the saved MIDI interface
+    state.state.setProperty ("savedMIDIId", "", nullptr);
+    state.state.setProperty ("oscPort", 0, nullptr);
+    state.state.setProperty ("sharedOut", false, nullptr);
+    // rebuild the pattern whenever any of its settings change
+    auto numPatternParams = 0;
+    for (auto* param : getParameters()) {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param)) {
+            if (isPatternParameter (ranged->paramID)) {
+                state.addParameterListener (ranged->paramID, this);
+                patternParameters[(size_t) numPatternParams++] = ranged;
+            }
+        }
+    }
+    jassert (numPatternParams == numPatternParameters);
+
+    // the parameters that can be MIDI learned
+    for (int i=0; i<numSteps; i++) {
+        midiLearn.addParameter ("chance" + std::to_string(i));
+        midiLearn.addParameter ("condition" + std::to_string(i));
+    }
+    midiLearn.addParameter ("stepLength");
+    midiLearn.addParameter ("reset");
+
+    publishPattern();
+
+    // changes to the pattern are picked up from here, rather than anything
+    // being triggered from the thread the parameter happened to change on
+    changePoller->add (this);
+
+    initialised = true;
+}
 
 
+//==============================================================================
+
+
+juce::AudioProcessorValueTreeState::ParameterLayout ChanceMachineAudioProcessor::createParameterLayout()
 {
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
 
     // FIRST ROW PARAMETERS ----------------------------------------------------
     // assume 16 parameters (for 16 chance sliders)
@@ -47,9 +143,9 @@ ChanceMachineAudioProcessor::ChanceMachineAudioProcessor()
         std::string display_name = extracted(i);
         auto attributes = juce::AudioParameterFloatAttributes().withStringFromValueFunction (
                         [] (auto x, auto) {
-                            return juce::String (static_cast<int>(x * 100));
+                            return getPercentText (static_cast<int>(x * 100));
                         }).withLabel ("%");
-        state.createAndAddParameter({ std::make_unique<juce::AudioParameterFloat> (juce::ParameterID(name, 1+i),  display_name, juce::NormalisableRange<float> (0.0f, 1.0f), 1.0f, attributes)});
+        layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID(name, 1+i),  display_name, juce::NormalisableRange<float> (0.0f, 1.0f), 1.0f, attributes));
         
     }
 
@@ -59,8 +155,7 @@ ChanceMachineAudioProcessor::ChanceMachineAudioProcessor()
     for (int i=0; i<num_params; i++) {
         auto name = "condition" + std::to_string(i);
         auto display_name = "Trig " + std::to_string(i+1);
-        state.createAndAddParameter(
-                    std::make_unique<juce::AudioParameterChoice> (juce::ParameterID(name, num_params+1),
+        layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID(name, num_params+1),
                     display_name, condition_options, 0));
         
     }
@@ -68,64 +163,135 @@ ChanceMachineAudioProcessor::ChanceMachineAudioProcessor()
     
     // THIRD ROW PARAMETERS ----------------------------------------------------
 
-    state.createAndAddParameter(
-            std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("stepLength", 40),
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("stepLength", 40),
             "Step Length", stepLength_options, stepLength_options.indexOf("1 / 16") ));
     
-    state.createAndAddParameter(
-            std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("reset", 41),
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("reset", 41),
             "Reset", reset_options, reset_options.indexOf("16")));
 
-    state.createAndAddParameter(
-            std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("sendOut", 42),
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("sendOut", 42),
             "Send Out", juce::StringArray {"Fwd host note", "CC", "CC inverted"}, 0));
 
-    juce::StringArray CCOptions;
-    for (auto i=0; i<=127; i++) {
-        CCOptions.add("CC " + std::to_string(i));
-    }
-    state.createAndAddParameter(
-            std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("CC", 43),
-            "CC", CCOptions, 0));
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("CC", 43),
+            "CC", CC_options, 0));
+
+    // the list of devices isn't known yet, so reserve a fixed number of slots
+    // and show the name of whichever device is currently in each one
+    auto midiAttributes = juce::AudioParameterChoiceAttributes().withStringFromValueFunction (
+                        [this] (auto index, auto) {
+                            return getMidiOutputName (index);
+                        });
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("midiSelect", 44),
+            "Midi Out", midiSelect_options, 0, midiAttributes));
+
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("channel", 43),
+            "Channel", channel_options, 0));
 
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("midiRate", 45),
+            "MIDI Rate Limit", midiRate_options, 0));
 
-    midiSelect.updateDeviceList();
+    layout.add (std::make_unique<juce::AudioParameterBool> (juce::ParameterID("clockOut", 49),
+            "Send MIDI Clock", false));
 
-    juce::StringArray midiOptions({"To Host"});
-    for (auto midiOut : midiSelect.midiOutputs) {
-        midiOptions.add(midiOut->deviceInfo.name);
+
+    // LATER PARAMETERS ----------------------------------------------------
+    // hosts find parameters by their index, so anything new goes at the end -
+    // otherwise automation in older projects would move the wrong parameter
+
+    // timing row: shift each step early or late, by up to half a step
+
+    auto timingAttributes = juce::AudioParameterFloatAttributes().withStringFromValueFunction (
+                    [] (auto x, auto) {
+                        return getPercentText (juce::roundToInt (x * 100));
+                    }).withLabel ("%");
+
+    for (int i=0; i<num_params; i++) {
+        auto name = "timing" + std::to_string(i);
+        auto display_name = "Timing " + std::to_string(i+1);
+        layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID(name, 50),
+                    display_name, juce::NormalisableRange<float> (-0.5f, 0.5f), 0.0f, timingAttributes));
     }
-    
-    state.createAndAddParameter(
-            std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("midiSelect", 44),
-            "Midi Out", midiOptions, 0));
 
+    for (int i=0; i<num_params; i++) {
+        auto name = "ratchet" + std::to_string(i);
+        auto display_name = "Ratchet " + std::to_string(i+1);
+        layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID(name, 50),
+                    display_name, ratchet_options, 0));
+    }
+
+    // delays every other step by this fraction of a step
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID("swing", 50),
+            "Swing", juce::NormalisableRange<float> (0.0f, 0.5f), 0.0f, timingAttributes));
+
+    // when changes to the pattern (or a newly loaded preset) take effect
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("patternSync", 51),
+            "Apply Changes At", patternSync_options, 0));
+
+    // switches on fills, for trigger conditions that use them
+    layout.add (std::make_unique<juce::AudioParameterBool> (juce::ParameterID("fill", 52),
+            "Fill", false));
 
-    juce::StringArray channelOptions;
-    for (auto i=1; i<=16; i++) {
-        channelOptions.add(std::to_string(i));
+    // make each step's chance depend on the step before (and on itself in the last cycle)
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("dependency", 53),
+            "Depends On", dependency_options, 0));
+
+    auto dependencyAttributes = juce::AudioParameterFloatAttributes().withStringFromValueFunction (
+                    [] (auto x, auto) {
+                        return getPercentText (juce::roundToInt (x * 100));
+                    }).withLabel ("%");
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID("dependencyAmount", 53),
+            "Dependency", juce::NormalisableRange<float> (-1.0f, 1.0f), 0.0f, dependencyAttributes));
+
+
+    // the standalone app has no host, so it needs a transport of its own
+    if (wrapperType == wrapperType_Standalone) {
+        layout.add (std::make_unique<juce::AudioParameterBool> (juce::ParameterID("play", 46),
+                "Play", false));
+
+        auto tempoAttributes = juce::AudioParameterFloatAttributes().withLabel ("BPM");
+        layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID("tempo", 47),
+                "Tempo", juce::NormalisableRange<float> (20.0f, 300.0f, 0.1f), 120.0f, tempoAttributes));
+
+        layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("timeSignature", 48),
+                "Time Signature", timeSignature_options, 0));
     }
-    state.createAndAddParameter(
-            std::make_unique<juce::AudioParameterChoice> (juce::ParameterID("channel", 43),
-            "Channel", channelOptions, 0));
 
+    return layout;
+}
 
-    // END PARAMTER SETUP --------------------------------------------
-    
-    
-    
-    midiSelectAttach = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(state, "midiSelect", midiSelect);
 
-    state.state = juce::ValueTree("ChancePlugin");
-    state.state.setProperty ("version", "0.2i", nullptr);
+//==============================================================================
 
-    // store the saved MIDI interface
-    state.state.setProperty ("savedMIDIId", "", nullptr);
-    initialised = true;
+
+juce::String ChanceMachineAudioProcessor::getMidiOutputName (int index) const
+{
+    // the texts are shared, so asking for them doesn't allocate
+    if (index > 0) {
+        auto name = midiRouter.getDeviceName (index - 1);
+        if (name.isNotEmpty()) return name;
+    }
+
+    return midiSelect_options[index];
 }
 
+
 ChanceMachineAudioProcessor::~ChanceMachineAudioProcessor()
 {
+    changePoller->remove (this);
+
+    for (auto* param : getParameters()) {
+        if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(param)) {
+            if (isPatternParameter (withID->paramID)) state.removeParameterListener (withID->paramID, this);
+        }
+    }
+}
+
+
+bool ChanceMachineAudioProcessor::isPatternParameter (const juce::String& paramID)
+{
+    return paramID.startsWith ("chance") || paramID.startsWith ("condition") || paramID.startsWith ("timing")
+        || paramID.startsWith ("ratchet") || paramID == "swing" || paramID == "stepLength" || paramID == "reset"
+        || paramID == "dependency" || paramID == "dependencyAmount";
 }
 
 //==============================================================================
@@ -169,22 +335,26 @@ double ChanceMachineAudioProcessor::getTailLengthSeconds() const
 
 int ChanceMachineAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return numPrograms;
 }
 
 int ChanceMachineAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void ChanceMachineAudioProcessor::setCurrentProgram (int index)
 {
+    requestedProgram = juce::jlimit (0, numPrograms - 1, index);
+
+    // hosts expect the new program to be selected straight away (otherwise the timer picks it up)
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        handleProgramChange();
 }
 
 const juce::String ChanceMachineAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return program_options[index];
 }
 
 void ChanceMachineAudioProcessor::changeProgramName (int index, const juce::String& newName)
@@ -199,12 +369,39 @@ void ChanceMachineAudioProcessor::prepareToPlay (double sampleRate, int samplesP
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    midiOptimiser.prepare (sampleRate);
+    midiRouter.setProcessing (true);
+    transport.prepare (sampleRate);
+    midiClock.prepare (sampleRate);
+    internalTransport.prepare (sampleRate);
+    clockGenerator.reset();
+    clockMessages.ensureSize (1024);
+    forwardedMidi.ensureSize (8192);
+    engine.reset();
+
+    // start with the latest pattern straight away
+    if (patternSnapshots.update()) {
+        nextPattern = patternSnapshots.read();
+    }
+    applyNextPattern (4);
+
+    // OSC time tags are real (wall clock) times
+    oscClockOffsetMs = static_cast<double>(juce::Time::currentTimeMillis()) - juce::Time::getMillisecondCounterHiRes();
+
+    scheduler.clear();
+    sampleClock = 0;
+    noteOnTimes.fill (0);
+    noteDelay = 0;
+    numStepNotes = 0;
 }
 
 void ChanceMachineAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+
+    // closed MIDI outputs don't have to wait for the next block to be deleted
+    midiRouter.setProcessing (false);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -242,112 +439,238 @@ bool ChanceMachineAudioProcessor::isBusesLayoutSupported (const BusesLayout& lay
 void ChanceMachineAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    std::uniform_int_distribution<std::mt19937::result_type> dist100(0,99); // distribution in range [0, 99]
-
-    float chance = 100; // start with a 100 - 100% chance
-    float midi_time = 0;
-    int reset = 16; // return to start after this amount of steps
-    float qnotes_per_bar = 4;  // how many quarter notes per bar - assume 4
-    float note_unit = 4; // i.e. 4 sixteenth notes per quarter note; use 2 for eight note etc.
-    float bpm = 120.0f; // assumed bpm – we'll read this from host if available
-    bool step_changed = false;
-    int channel = 1;
-    
-    // get values from state if available
-    auto stepLength_param = state.getParameter ("stepLength");
-    if (stepLength_param != nullptr) {
-        auto stepLength = stepLength_values.find( stepLength_param->getCurrentValueAsText() ) -> second;
-        note_unit = static_cast<float>(stepLength) / 4;
-    }
-
-    auto reset_param = state.getParameter ("reset");
-    if (reset_param != nullptr) {
-        reset = std::stoi(reset_param->getCurrentValueAsText().toStdString());
-    }
-
-    auto channel_param = state.getParameter ("channel");
-    if (channel_param != nullptr) {
-        channel = std::stoi(channel_param ->getCurrentValueAsText().toStdString());
-    }
-
-    
-    juce::MidiBuffer processedMidi;
+    TraceRecorder::Scope trace ("processBlock");
+
+    // external MIDI outputs time their messages from here
+    auto blockStartMs = juce::Time::getMillisecondCounterHiRes();
+    oscBlockStartMs = blockStartMs + oscClockOffsetMs;
+
+    double midi_time = 0;
+    double bpm = 120.0; // assumed bpm – we'll read this from host if available
+    bool time_moving = false; // only if the host (or MIDI clock) tells us where we are
+    double ppq_per_sample = 0;
+    double qnotes_per_bar = 4;  // how many quarter notes per bar - assume 4
+    bool transport_playing = true; // assume we're playing unless the host tells us otherwise
+    auto transport_change = TransportTracker::Change::none;
+    auto numSamples = buffer.getNumSamples();
+
+    int channel = static_cast<int>(channelValue->load()) + 1;
+    int sendOut = static_cast<int>(sendOutValue->load()); // notes or CC
+    int CC = static_cast<int>(CCValue->load());
+
+    // limit the amount of MIDI traffic sent to each output, if required
+    auto midiRate = static_cast<int>(midiRateValue->load());
+    midiOptimiser.setMaxMessagesPerSecond (midiRate_values[(size_t) juce::jlimit (0, (int) midiRate_values.size() - 1, midiRate)]);
+    midiOptimiser.beginBlock (numSamples);
+    midiRouter.beginBlock();
 
     // get real playhead position / time from host, if available
     juce::AudioPlayHead *playHead = getPlayHead();
     if(playHead != NULL) {
         if (auto pos = playHead->getPosition()) {
-            if (auto real_time = pos->getPpqPosition()) {
-                midi_time = *real_time;
-            }
-            if (auto signature = pos->getTimeSignature()) {
-                qnotes_per_bar = static_cast<float>(signature->numerator) / static_cast<float>(signature->denominator) * 4;
+            if (pos->getPpqPosition().hasValue()) {
+                // follow loops, jumps and stop/start, so we can resync straight away
+                transport_change = transport.update (*pos, numSamples);
+                transport_playing = transport.isPlaying();
+                midi_time = transport.getContinuousPpq();
+                time_moving = true;
             }
             if (auto b = pos->getBpm()) {
-                bpm = static_cast<float>(*b);
+                bpm = *b;
+            }
+            if (auto signature = pos->getTimeSignature()) {
+                qnotes_per_bar = static_cast<double>(signature->numerator) / static_cast<double>(signature->denominator) * 4;
             }
         }
     }
-    
-    // figure out which step we're on
-    // assume a safe number for host latency (in seconds)
-    auto latency = 0.015f;
-    auto bps = bpm / 60.0f;
-    int steps_total = static_cast<int>((midi_time + (latency * bps)) * note_unit);
-    int step = steps_total % reset;
-    int cycle = steps_total / reset;
-
-    // on step change
-    if (steps_total != previous_steps) {
-        currentStep = step;
-        previous_steps = steps_total;
-        step_changed = true;
-        
-        // read chance from appropriate slider
-        auto chance_param = state.getParameter ("chance" + std::to_string(step));
-        if (chance_param != nullptr) {
-            chance = chance_param ->getValue() * 100;
-        }
-        
-        // read trigger condition parameter
-        juce::String condition = "1:1";
-        auto condition_param = state.getParameter ("condition" + std::to_string(step));
-        if (condition_param != nullptr) {
-            condition = condition_param ->getCurrentValueAsText();
-        }
-        juce::StringArray c;
-        c.addTokens (condition, ":", "");
-
-        // set step on or off state, depending the condition parameter
-        // so only turn on every A out of B cycles (c[0] = A; c[1] = B)
-        int current_cycle = cycle % std::stoi(c[1].toStdString()) + 1;
-        if (current_cycle == std::stoi(c[0].toStdString()) ) {
-            step_on = true;
+
+    auto sampleRate = getSampleRate() > 0 ? getSampleRate() : 44100.0;
+    if (time_moving) {
+        ppq_per_sample = bpm / 60.0 / sampleRate;
+    }
+
+    // program change messages switch to another pattern in the bank (at the next bar),
+    // and CCs move whatever they've been MIDI learned to. Both only leave a value for
+    // the message thread to pick up, so nothing here waits on it.
+    for (const auto metadata : midiMessages) {
+        auto type = metadata.data[0] & 0xf0;
+
+        if (type == 0xc0 && metadata.numBytes >= 2) {
+            requestedProgram.store (metadata.data[1], std::memory_order_relaxed);
         }
-        else {
-            step_on = false;
+        else if (type == 0xb0 && metadata.numBytes >= 3) {
+            midiLearn.handleController (metadata.data[0] & 0x0f, metadata.data[1], metadata.data[2]);
         }
+    }
+
+    // without a host position (e.g. in the standalone app), follow incoming MIDI clock instead
+    auto clock_change = midiClock.update (midiMessages, numSamples);
+    if (! time_moving && midiClock.isActive()) {
+        transport_change = clock_change;
+        transport_playing = midiClock.isRunning();
+        midi_time = midiClock.getPpqPosition();
+        ppq_per_sample = midiClock.getPpqPerSample();
+        bpm = midiClock.getBpm();
+    }
+    // otherwise, in the standalone app, run our own transport
+    else if (! time_moving && playValue != nullptr) {
+        transport_change = internalTransport.update (playValue->load() > 0.5f, tempoValue->load(), numSamples);
+        transport_playing = internalTransport.isPlaying();
+        midi_time = internalTransport.getPpqPosition();
+        ppq_per_sample = internalTransport.getPpqPerSample();
+        bpm = internalTransport.getBpm();
+
+        auto signature = timeSignature_values[(size_t) juce::jlimit (0, timeSignature_options.size() - 1,
+                                                                     static_cast<int>(timeSignatureValue->load()))];
+        qnotes_per_bar = static_cast<double>(signature.first) / static_cast<double>(signature.second) * 4;
+    }
 
-        // set step to off if required, depending on the chance setting
-        float rnd = dist100(rng);
-        if (chance <= rnd) step_on = false;
+    // pick up the latest pattern from the message thread - it's switched over at the next boundary
+    if (patternSnapshots.update()) {
+        nextPattern = patternSnapshots.read();
+        patternPending = true;
+    }
 
-        sendChangeMessage ();
+    // when rendering offline, don't wait for the message thread - build it here, so
+    // automation takes effect at the same place in every bounce
+    if (isNonRealtime() && patternDirty.exchange (false)) {
+        buildPattern (nextPattern);
+        patternPending = true;
+    }
+
+    engine.setFill (fillValue->load() > 0.5f);
+
+    // a bar isn't always 4 quarter notes long
+    if (patternStepIsBar && qnotes_per_bar > 0) {
+        pattern.stepsPerQuarterNote = 1.0 / qnotes_per_bar;
     }
     
-    // check what kind of message we want to send (notes or CC)
-    auto sendOutParam = state.getParameter ("sendOut");
-    int sendOut = static_cast<int>(sendOutParam ->convertFrom0to1(sendOutParam ->getValue()));
+    // figure out where this block is on the timeline
+    // assume a safe number for host latency (in seconds) and look that far ahead
+    auto latency = 0.015;
+    auto bps = bpm / 60.0;
+
+    SequencerTimeline timeline;
+    timeline.ppqStart = midi_time + latency * bps;
+    timeline.ppqPerSample = ppq_per_sample;
+    timeline.numSamples = numSamples;
+    timeline.playing = transport_playing;
+
+    auto blockStart = sampleClock;
+    auto blockEnd = sampleClock + numSamples;
+    sampleClock = blockEnd;
+    step_changed = false;
+
+    // when the transport stops, leave the step switched on so the sound isn't left muted
+    bool transport_stopped = transport_change == TransportTracker::Change::stopped;
+    bool clock_out = clockOutValue->load() > 0.5f;
+
+    // evaluates the steps in part of this block and schedules them
+    auto processSteps = [&] (const SequencerTimeline& span, int offset) {
+        TraceRecorder::Scope traceSteps ("evaluate steps");
+        auto numEvents = engine.process (pattern, span, stepEvents.data(), static_cast<int>(stepEvents.size()));
+
+        for (auto i=0; i<numEvents; i++) {
+            auto event = stepEvents[(size_t) i];
+            event.samplePosition += offset;
+            scheduleStep (event, timeline, blockStart, sendOut);
+        }
+    };
+
+    // after a jump or restart, anything still waiting to be played is dropped and the
+    // step at the new position is evaluated straight away (loops just keep counting)
+    auto restarted = transport_change == TransportTracker::Change::started
+                  || transport_change == TransportTracker::Change::jumped;
+
+    // there's no need to wait for a boundary if we're not playing (or starting again anyway)
+    if (patternPending && (restarted || ! transport_playing || ppq_per_sample <= 0)) {
+        applyNextPattern (qnotes_per_bar);
+    }
+
+    if (restarted) {
+        engine.reset();
+        scheduler.clear();
+
+        auto now = timeline;
+        now.ppqPerSample = 0.0;
+        processSteps (now, 0);
+    }
+    if (transport_stopped) {
+        scheduler.clear();
+    }
+
+    // steps can be played up to half a step early, so evaluate them that much ahead
+    // of time and schedule their output for when they're actually due
+    auto early = timeline;
+    early.ppqStart += 0.5 / pattern.stepsPerQuarterNote;
+
+    // if a new pattern is waiting, switch to it at the boundary (if there's one in this block)
+    auto boundary = patternPending ? findPatternBoundary (early, qnotes_per_bar) : -1;
+
+    if (boundary >= 0) {
+        auto before = early;
+        before.numSamples = boundary;
+        processSteps (before, 0);
+
+        applyNextPattern (qnotes_per_bar);
+
+        auto after = early;
+        after.ppqStart += boundary * early.ppqPerSample;
+        after.numSamples -= boundary;
+        processSteps (after, boundary);
+    }
+    else {
+        processSteps (early, 0);
+    }
+
+    // plays whatever is due from the scheduler into the given buffer
+    auto playScheduled = [&] (juce::MidiBuffer& output, juce::int64 until) {
+        scheduler.processUntil (until, [&] (juce::int64 time, const ScheduledEvent& event) {
+            handleScheduledEvent (time, event, output, blockStart, sendOut, channel, CC);
+        });
+    };
 
     // process midi message when available
     // only process notes if selected option is to forward incoming midi notes
     if (sendOut == 0) {
+        // the buffer is reused, and swapped with the host's at the end - so after a few
+        // blocks both are big enough for whatever comes in, and nothing is allocated
+        auto& processedMidi = forwardedMidi;
+        processedMidi.clear();
+        auto toOutputs = midiRouter.isSending();
+
+        // don't leave notes hanging after the transport stops or jumps
+        if (transport_stopped || transport_change == TransportTracker::Change::jumped) {
+            auto message = juce::MidiMessage::allNotesOff (channel);
+            midiRouter.sendToMidiOutputs (message);
+            processedMidi.addEvent (message, 0);
+        }
+
         for (const auto metadata : midiMessages)
         {
-            auto message = metadata.getMessage();
             auto time = metadata.samplePosition;
+
+            // we're sending our own clock, so don't pass on anyone else's
+            if (clock_out && isClockMessage (metadata.data)) continue;
+
+            // catch up with any steps that started before (or with) this message
+            playScheduled (processedMidi, blockStart + time + 1);
+
+            // anything that isn't a note (pitch bend, aftertouch, CCs, clock...) goes
+            // straight through as raw bytes, just moved to our channel
+            auto type = metadata.data[0] & 0xf0;
+
+            if ((type != 0x80 && type != 0x90) || metadata.numBytes < 3) {
+                forwardMidi (processedMidi, metadata.data, metadata.numBytes, time, channel, toOutputs);
+                continue;
+            }
+
+            auto message = metadata.getMessage();
+
+            // learn from what's played, before it's let through or not
+            if (message.isNoteOn() && stepLearner.isLearning()) {
+                stepLearner.noteOn();
+            }
             
             // only pass through note on messsage according to chance setting (step_on),
             // but let other messages through normally
@@ -355,40 +678,555 @@ void ChanceMachineAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer
                 // set the chosen output channel
                 message.setChannel(channel);
 
-                // send to selected external MIDI outputs
-                midiSelect.sendToMidiOutputs (message);
-
-                // add to host's MIDI buffer
-                processedMidi.addEvent (message, time);
+                if (message.isNoteOnOrOff()) {
+                    auto now = blockStart + time;
+                    auto due = now + noteDelay;
+                    auto note = static_cast<size_t>(message.getNoteNumber());
+
+                    if (message.isNoteOn()) {
+                        noteOnTimes[note] = due;
+
+                        // remember what was played in this step, for ratchets
+                        if (numStepNotes < static_cast<int>(stepNotes.size())) {
+                            stepNotes[(size_t) numStepNotes++] = { message.getNoteNumber(), message.getVelocity() };
+                        }
+                    }
+                    else {
+                        // never let a note end before it has started
+                        due = juce::jmax (due, noteOnTimes[note]);
+                    }
+
+                    // play the note late, if this step is shifted
+                    if (due > now && scheduleMessage (due, message)) continue;
+                }
+
+                sendMidi (processedMidi, message, time);
             }
         }
+
+        playScheduled (processedMidi, blockEnd);
         midiMessages.swapWith (processedMidi);
     }
-    
-    // if we're sending out CC
-    if (sendOut > 0 && step_changed) {
-        auto CCParam = state.getParameter ("CC");
-        int CC = static_cast<int>(CCParam ->convertFrom0to1(CCParam ->getValue()));
-        auto value = 0; // default value is set to off
-        
-        // if send CC (127 for on)
-        if (sendOut == 1) {
-            if (step_on) value = 127;
+
+    // send any CC values held back in previous blocks by the rate limit
+    midiOptimiser.drainPending (MIDIOutputOptimiser::hostPort, [&midiMessages] (const juce::MidiMessage& m) {
+        midiMessages.addEvent (m, 0);
+    });
+    midiRouter.sendPendingToMidiOutputs();
+
+    // if we're sending out CC, the scheduled steps are sent here
+    if (sendOut > 0) {
+        playScheduled (midiMessages, blockEnd);
+    }
+
+    if (transport_stopped) {
+        step_on = true;
+
+        if (sendOut > 0) {
+            sendStepCC (midiMessages, sendOut, channel, CC, 0);
         }
-        // if send inverted CC (127 for off)
-        else {
-            if (!step_on) value = 127;
+    }
+
+    if (step_changed) {
+        sendChangeMessage ();
+    }
+
+    // send MIDI clock for the actual song position (i.e. without looking ahead)
+    if (clock_out) {
+        auto clockTimeline = timeline;
+        clockTimeline.ppqStart = midi_time;
+
+        clockMessages.clear();
+        clockGenerator.process (clockTimeline, transport_change, clockMessages);
+
+        for (const auto metadata : clockMessages) {
+            sendMidi (midiMessages, metadata.getMessage(), metadata.samplePosition);
         }
+    }
+    else {
+        clockGenerator.reset();
+    }
 
-        auto message = juce::MidiMessage::controllerEvent (channel, CC, value);
-        
-        // send to selected external MIDI outputs
-        midiSelect.sendToMidiOutputs (message);
-        
-        // add to host's MIDI buffer
-        midiMessages.addEvent(message, 0);
+    midiRouter.flushMidiOutputs (blockStartMs, sampleRate);
+    oscSender.endBlock();
+
+    // keep what was actually played, if we're recording a take
+    takeRecorder.addBlock (midiMessages, numSamples, bpm, sampleRate);
+}
+
+
+//==============================================================================
+
+
+void ChanceMachineAudioProcessor::scheduleStep (const SequencerEvent& event, const SequencerTimeline& timeline,
+                                                juce::int64 blockStart, int sendOut)
+{
+    // where the step sits on the grid, in samples
+    auto gridTime = static_cast<double>(blockStart + event.samplePosition);
+    auto stepSamples = 0.0;
+
+    if (timeline.ppqPerSample > 0) {
+        gridTime = static_cast<double>(blockStart) + (event.ppq - timeline.ppqStart) / timeline.ppqPerSample;
+        stepSamples = 1.0 / (pattern.stepsPerQuarterNote * timeline.ppqPerSample);
+    }
+
+    auto offset = pattern.getTimingOffset (event.lane, event.step) * stepSamples;
+    auto ratchets = juce::jmax (1, static_cast<int>(pattern.steps[(size_t) event.lane][(size_t) event.step].ratchets));
+    auto ratchetSamples = stepSamples / ratchets;
+
+    // nothing can be played before the start of this block
+    auto at = [blockStart] (double time) {
+        return juce::jmax (blockStart, static_cast<juce::int64>(std::ceil (time)));
+    };
+
+    ScheduledEvent step;
+    step.type = ScheduledEvent::Type::step;
+    step.on = event.fired;
+    step.step = static_cast<juce::int16>(event.step);
+    step.cycle = static_cast<juce::int32>(event.cycle);
+
+    if (sendOut == 0) {
+        // host notes are let through (or not) by the step they fall in on the grid,
+        // and are then played late by the step's offset. They can't be played early.
+        auto delay = juce::jmax (0.0, offset);
+        step.length = static_cast<juce::int32>(delay);
+        schedule (at (gridTime), step);
+
+        // when learning, notes count towards the nearest step (so from half way through the one before)
+        if (stepLearner.isLearning()) {
+            ScheduledEvent learn;
+            learn.type = ScheduledEvent::Type::learn;
+            learn.step = static_cast<juce::int16>(event.step);
+            learn.cycle = static_cast<juce::int32>(event.cycle);
+            schedule (at (gridTime - 0.5 * stepSamples), learn);
+        }
+
+        // repeat the notes played in this step
+        for (auto i=1; event.fired && i<ratchets; i++) {
+            ScheduledEvent retrigger;
+            retrigger.type = ScheduledEvent::Type::retrigger;
+            retrigger.length = static_cast<juce::int32>(ratchetSamples / 2);
+            schedule (at (gridTime + delay + i * ratchetSamples), retrigger);
+        }
+    }
+    else {
+        schedule (at (gridTime + offset), step);
+
+        // switch the CC off and on again for each ratchet
+        for (auto i=1; event.fired && i<ratchets; i++) {
+            ScheduledEvent ratchet;
+            ratchet.type = ScheduledEvent::Type::ratchet;
+            ratchet.on = false;
+            schedule (at (gridTime + offset + (i - 0.5) * ratchetSamples), ratchet);
+            ratchet.on = true;
+            schedule (at (gridTime + offset + i * ratchetSamples), ratchet);
+        }
     }
+}
+
+
+bool ChanceMachineAudioProcessor::scheduleMessage (juce::int64 time, const juce::MidiMessage& message)
+{
+    if (message.getRawDataSize() > 3) return false;
+
+    ScheduledEvent event;
+    event.type = ScheduledEvent::Type::message;
+    event.numBytes = static_cast<juce::uint8>(message.getRawDataSize());
+    std::copy_n (message.getRawData(), event.numBytes, event.bytes.begin());
+
+    return schedule (time, event);
+}
+
+
+bool ChanceMachineAudioProcessor::schedule (juce::int64 time, const ScheduledEvent& event)
+{
+    if (scheduler.schedule (time, event)) return true;
+
+    // the queue has room for far more than a busy pattern needs, so this shouldn't
+    // happen - but if it does, keep count rather than lose events without a trace
+    jassertfalse;
+    droppedEvents.fetch_add (1, std::memory_order_relaxed);
+    return false;
+}
+
+
+void ChanceMachineAudioProcessor::handleScheduledEvent (juce::int64 time, const ScheduledEvent& event, juce::MidiBuffer& output,
+                                                        juce::int64 blockStart, int sendOut, int channel, int CC)
+{
+    auto samplePosition = static_cast<int>(time - blockStart);
+
+    switch (event.type)
+    {
+        case ScheduledEvent::Type::step:
+            currentStep = event.step;
+            step_changed = true;
+            noteDelay = event.length;
+            numStepNotes = 0;
+            step_on = event.on;
+            if (sendOut > 0) sendStepCC (output, sendOut, channel, CC, samplePosition);
+
+            if (oscSender.isEnabled()) {
+                oscSender.addStep (getEventTimeMs (samplePosition), event.step, event.on, event.cycle);
+                if (event.on) oscSender.addTrigger (getEventTimeMs (samplePosition), event.step);
+            }
+            break;
+
+        case ScheduledEvent::Type::ratchet:
+            step_on = event.on;
+            if (sendOut > 0) sendStepCC (output, sendOut, channel, CC, samplePosition);
+
+            if (event.on && oscSender.isEnabled()) oscSender.addTrigger (getEventTimeMs (samplePosition), currentStep);
+            break;
+
+        case ScheduledEvent::Type::retrigger:
+            if (oscSender.isEnabled()) oscSender.addTrigger (getEventTimeMs (samplePosition), currentStep);
+
+            for (auto i=0; i<numStepNotes; i++) {
+                auto note = stepNotes[(size_t) i];
+                sendMidi (output, juce::MidiMessage::noteOff (channel, note.first), samplePosition);
+
+                // without a note off to end it, the note would hang - so leave it off
+                if (scheduleMessage (time + event.length, juce::MidiMessage::noteOff (channel, note.first)))
+                    sendMidi (output, juce::MidiMessage::noteOn (channel, note.first, note.second), samplePosition);
+            }
+            break;
+
+        case ScheduledEvent::Type::learn:
+            stepLearner.stepStarted (event.step, event.cycle);
+            break;
+
+        case ScheduledEvent::Type::message:
+            sendMidi (output, juce::MidiMessage (event.bytes.data(), event.numBytes), samplePosition);
+            break;
+    }
+}
+
+
+double ChanceMachineAudioProcessor::getEventTimeMs (int samplePosition) const
+{
+    auto sampleRate = getSampleRate() > 0 ? getSampleRate() : 44100.0;
+    return oscBlockStartMs + samplePosition * 1000.0 / sampleRate;
+}
+
+
+void ChanceMachineAudioProcessor::setOscPort (int port)
+{
+    oscSender.setPort (port);
+    state.state.setProperty ("oscPort", oscSender.getPort(), nullptr);
+}
+
+
+bool ChanceMachineAudioProcessor::setConditionExpression (int step, const juce::String& text, juce::String& error)
+{
+    if (step < 0 || step >= numSteps) return false;
+
+    // compiled here, so the audio thread only ever runs the result
+    SequencerCondition condition;
+    std::string reason;
+
+    if (! ConditionExpression::compile (text.trim().toStdString(), condition, reason)) {
+        error = reason;
+        return false;
+    }
+
+    {
+        const juce::SpinLock::ScopedLockType lock (conditionExpressionsLock);
+        conditionExpressions[(size_t) step] = condition;
+    }
+
+    // kept with the rest of the state, so it's saved with the project
+    auto expressions = state.state.getOrCreateChildWithName ("Conditions", nullptr);
+    auto name = juce::Identifier ("step" + std::to_string(step));
+
+    if (condition.isEmpty())    expressions.removeProperty (name, nullptr);
+    else                        expressions.setProperty (name, text.trim(), nullptr);
+
+    patternDirty = true;
+    return true;
+}
+
+
+juce::String ChanceMachineAudioProcessor::getConditionExpression (int step) const
+{
+    return state.state.getChildWithName ("Conditions").getProperty (juce::Identifier ("step" + std::to_string(step))).toString();
+}
+
+
+void ChanceMachineAudioProcessor::restoreConditionExpressions ()
+{
+    // compiled first, so the lock is only held while they're copied over
+    std::array<SequencerCondition, numSteps> expressions {};
+
+    for (int i=0; i<numSteps; i++) {
+        std::string reason;
+        ConditionExpression::compile (getConditionExpression (i).toStdString(), expressions[(size_t) i], reason);
+    }
+
+    {
+        const juce::SpinLock::ScopedLockType lock (conditionExpressionsLock);
+        conditionExpressions = expressions;
+    }
+
+    patternDirty = true;
+}
+
+
+void ChanceMachineAudioProcessor::applyLearnedPattern()
+{
+    // write what the learner heard into the chance and condition of each step
+    for (int i=0; i<numSteps; i++) {
+        auto suggestion = stepLearner.getSuggestion (i);
+        if (! suggestion.isValid) continue;
+
+        if (auto* chance = state.getParameter ("chance" + std::to_string(i))) {
+            chance->setValueNotifyingHost (chance->convertTo0to1 (suggestion.chance));
+        }
+
+        auto condition = std::find (condition_values.begin(), condition_values.end(),
+                                    std::make_pair (suggestion.conditionA, suggestion.conditionB));
+
+        auto* conditionParam = state.getParameter ("condition" + std::to_string(i));
+
+        // the learned condition replaces any expression
+        juce::String error;
+        setConditionExpression (i, {}, error);
+
+        if (conditionParam != nullptr && condition != condition_values.end()) {
+            auto index = static_cast<float>(std::distance (condition_values.begin(), condition));
+            conditionParam->setValueNotifyingHost (conditionParam->convertTo0to1 (index));
+        }
+    }
+}
+
+
+void ChanceMachineAudioProcessor::sendMidi (juce::MidiBuffer& output, const juce::MidiMessage& message, int samplePosition)
+{
+    // send to selected external MIDI outputs
+    midiRouter.sendToMidiOutputs (message, samplePosition);
+
+    // add to host's MIDI buffer
+    output.addEvent (message, samplePosition);
+}
+
+
+bool ChanceMachineAudioProcessor::isClockMessage (const juce::uint8* data)
+{
+    // clock, start, continue, stop and song position
+    return data[0] == 0xf8 || data[0] == 0xfa || data[0] == 0xfb || data[0] == 0xfc || data[0] == 0xf2;
+}
+
+
+void ChanceMachineAudioProcessor::forwardMidi (juce::MidiBuffer& output, const juce::uint8* data, int numBytes,
+                                               int samplePosition, int channel, bool toOutputs)
+{
+    // channel messages are at most 3 bytes, so the copy with our channel fits on the stack
+    std::array<juce::uint8, 3> rechannelled {};
+
+    if (numBytes <= 3 && (data[0] & 0xf0) != 0xf0) {
+        std::copy (data, data + numBytes, rechannelled.begin());
+        rechannelled[0] = static_cast<juce::uint8>((data[0] & 0xf0) | ((channel - 1) & 0x0f));
+        data = rechannelled.data();
+    }
+
+    // external outputs need a MidiMessage - but only make one if something's listening
+    if (toOutputs) {
+        midiRouter.sendToMidiOutputs (juce::MidiMessage (data, numBytes), samplePosition);
+    }
+
+    output.addEvent (data, numBytes, samplePosition);
+}
+
+
+void ChanceMachineAudioProcessor::sendStepCC (juce::MidiBuffer& midiMessages, int sendOut, int channel, int CC, int samplePosition)
+{
+    auto value = 0; // default value is set to off
+    
+    // if send CC (127 for on)
+    if (sendOut == 1) {
+        if (step_on) value = 127;
+    }
+    // if send inverted CC (127 for off)
+    else {
+        if (!step_on) value = 127;
+    }
+
+    auto message = juce::MidiMessage::controllerEvent (channel, CC, value);
     
+    // send to selected external MIDI outputs
+    midiRouter.sendToMidiOutputs (message, samplePosition);
+    
+    // add to host's MIDI buffer, unless the host already has this value
+    if (midiOptimiser.filter (MIDIOutputOptimiser::hostPort, message))
+        midiMessages.addEvent(message, samplePosition);
+}
+
+
+//==============================================================================
+
+
+void ChanceMachineAudioProcessor::parameterChanged (const juce::String&, float)
+{
+    // this can be called from any thread (including the audio thread), so only flag it.
+    // Lots of changes at once (e.g. loading a preset) only build one new pattern.
+    patternDirty = true;
+}
+
+
+void ChanceMachineAudioProcessor::pollChanges()
+{
+    midiLearn.update();
+
+    // nothing to do most of the time
+    if (requestedProgram.load (std::memory_order_relaxed) < 0 && ! patternDirty.load (std::memory_order_relaxed))
+        return;
+
+    // switch to a program that was asked for (by the host or a MIDI program change)
+    handleProgramChange();
+
+    // when rendering offline, the audio thread builds the pattern itself
+    if (! isNonRealtime() && patternDirty.exchange (false))
+        publishPattern();
+}
+
+
+void ChanceMachineAudioProcessor::handleProgramChange ()
+{
+    // switch to another program, if one was asked for
+    auto program = requestedProgram.exchange (-1);
+    if (program < 0) return;
+
+    const juce::ScopedLock lock (programLock);
+    if (program == currentProgram) return;
+
+    storeProgram (currentProgram);
+    currentProgram = program;
+    loadProgram (program);
+
+    // loading sets every pattern parameter, but they're all in this one pattern. Every
+    // pattern from now on belongs to the new program, so the audio thread keeps waiting
+    // for the next bar however many more come before it
+    patternDirty = false;
+    publishPattern();
+}
+
+
+void ChanceMachineAudioProcessor::storeProgram (int program)
+{
+    auto& values = programBank[(size_t) program];
+
+    for (size_t i=0; i<patternParameters.size(); i++) {
+        values[i] = static_cast<juce::uint16>(juce::roundToInt (patternParameters[i]->getValue() * 65535.0f));
+    }
+    programUsed[(size_t) program] = true;
+}
+
+
+void ChanceMachineAudioProcessor::loadProgram (int program)
+{
+    auto& values = programBank[(size_t) program];
+
+    for (size_t i=0; i<patternParameters.size(); i++) {
+        auto* param = patternParameters[i];
+
+        // programs that haven't been used yet start with a blank pattern
+        auto value = programUsed[(size_t) program] ? static_cast<float>(values[i]) / 65535.0f : param->getDefaultValue();
+        param->setValueNotifyingHost (value);
+    }
+}
+
+
+void ChanceMachineAudioProcessor::publishPattern ()
+{
+    auto& snapshot = patternSnapshots.getWriteBuffer();
+    buildPattern (snapshot);
+    patternSnapshots.publish();
+}
+
+
+void ChanceMachineAudioProcessor::buildPattern (PatternSnapshot& snapshot) const
+{
+    // gather every setting into one complete pattern, so the audio thread never
+    // plays a step with some values old and some new
+    auto& next = snapshot.pattern;
+
+    for (int i=0; i<numSteps; i++) {
+        auto& step = next.steps[0][(size_t) i];
+        step.chance = chanceValues[(size_t) i]->load();
+
+        auto condition = condition_values[(size_t) juce::jlimit (0, condition_options.size() - 1,
+                                                                 static_cast<int>(conditionValues[(size_t) i]->load()))];
+        step.conditionA = static_cast<juce::uint8>(condition.first);
+        step.conditionB = static_cast<juce::uint8>(condition.second);
+
+        step.offset = timingValues[(size_t) i]->load();
+        step.ratchets = static_cast<juce::uint8>(juce::jlimit (1, ratchet_options.size(), static_cast<int>(ratchetValues[(size_t) i]->load()) + 1));
+    }
+
+    {
+        // only ever held for a copy, so it's fine for an offline render to wait for it
+        const juce::SpinLock::ScopedLockType lock (conditionExpressionsLock);
+
+        for (int i=0; i<numSteps; i++)
+            next.steps[0][(size_t) i].expression = conditionExpressions[(size_t) i];
+    }
+
+    next.swing = swingValue->load();
+
+    // i.e. 4 sixteenth notes per quarter note; use 2 for eight note etc.
+    auto stepLength = stepLength_options[juce::jlimit (0, stepLength_options.size() - 1, static_cast<int>(stepLengthValue->load()))];
+    auto stepLength_value = stepLength_values.find (stepLength);
+    if (stepLength_value != stepLength_values.end()) {
+        next.stepsPerQuarterNote = static_cast<double>(stepLength_value->second) / 4;
+
+        // the length of a bar is only known on the audio thread
+        snapshot.stepIsBar = stepLength_value->second == 1;
+    }
+
+    // return to start after this amount of steps
+    next.reset = static_cast<int>(resetValue->load()) + 1;
+
+    // work out each step's chance after hits and misses here, so the audio thread only looks them up
+    auto dependency = juce::jlimit (0, dependency_options.size() - 1, static_cast<int>(dependencyValue->load()));
+    next.setDependency (static_cast<Engine::Pattern::Dependency>(dependency), dependencyAmountValue->load());
+
+    snapshot.program = currentProgram;
+}
+
+
+void ChanceMachineAudioProcessor::applyNextPattern (double qnotes_per_bar)
+{
+    pattern = nextPattern.pattern;
+    patternStepIsBar = nextPattern.stepIsBar;
+    patternPending = false;
+    playingProgram = nextPattern.program;
+
+    if (patternStepIsBar && qnotes_per_bar > 0) {
+        pattern.stepsPerQuarterNote = 1.0 / qnotes_per_bar;
+    }
+}
+
+
+int ChanceMachineAudioProcessor::findPatternBoundary (const SequencerTimeline& span, double qnotes_per_bar) const
+{
+    auto spq = pattern.stepsPerQuarterNote;
+    auto sync = static_cast<int>(patternSyncValue->load());
+
+    // switching to another program always waits for (at least) the next bar
+    if (patternPending && nextPattern.program != playingProgram) sync = juce::jmax (1, sync);
+    auto boundary = span.ppqStart;
+
+    // next bar
+    if (sync == 1 && qnotes_per_bar > 0) {
+        boundary = std::ceil (span.ppqStart / qnotes_per_bar) * qnotes_per_bar;
+    }
+    // next step, or the next time the pattern resets
+    else if (spq > 0) {
+        auto steps = sync == 2 ? juce::jlimit (1, numSteps, pattern.reset) : 1;
+        boundary = std::ceil (span.ppqStart * spq / steps) * steps / spq;
+    }
+
+    auto offset = std::ceil ((boundary - span.ppqStart) / span.ppqPerSample);
+    return offset < span.numSamples ? juce::jmax (0, static_cast<int>(offset)) : -1;
 }
 
 
@@ -419,21 +1257,63 @@ juce::AudioProcessorEditor* ChanceMachineAudioProcessor::createEditor()
 
 void ChanceMachineAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
+    TraceRecorder::Scope trace ("save state");
+
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
 
     // make sure we save the midi out interface setting
-    state.state.setProperty("savedMIDIId", midiSelect.midiId, nullptr);
+    state.state.setProperty("savedMIDIId", midiRouter.midiId, nullptr);
+
+    auto stateCopy = state.copyState();
+
+    // save the pattern bank - only the programs that have been used, as 16 bit values
+    const juce::ScopedLock lock (programLock);
+    storeProgram (currentProgram);
+
+    juce::ValueTree programs ("Programs");
+    programs.setProperty ("current", currentProgram.load(), nullptr);
+
+    for (auto i=0; i<numPrograms; i++) {
+        if (programUsed[(size_t) i]) {
+            juce::MemoryBlock data;
+            for (auto value : programBank[(size_t) i]) {
+                auto littleEndian = juce::ByteOrder::swapIfBigEndian (value);
+                data.append (&littleEndian, sizeof (littleEndian));
+            }
+
+            juce::ValueTree program ("Program");
+            program.setProperty ("index", i, nullptr);
+            program.setProperty ("values", data.toBase64Encoding(), nullptr);
+            programs.appendChild (program, nullptr);
+        }
+    }
+
+    stateCopy.removeChild (stateCopy.getChildWithName ("Programs"), nullptr);
+    stateCopy.appendChild (programs, nullptr);
 
     // Store an xml representation of our state.
-    if (auto xmlState = state.copyState().createXml())
+    if (auto xmlState = stateCopy.createXml())
         copyXmlToBinary (*xmlState, destData);
 
 }
 
+bool ChanceMachineAudioProcessor::exportPattern (const juce::File& file) const
+{
+    // only the current pattern (the bank and the MIDI learn mappings stay with the project)
+    auto pattern = state.copyState();
+    pattern.removeChild (pattern.getChildWithName ("Programs"), nullptr);
+    pattern.removeChild (pattern.getChildWithName ("MidiLearn"), nullptr);
+
+    auto xml = pattern.createXml();
+    return xml != nullptr && xml->writeTo (file);
+}
+
 void ChanceMachineAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    TraceRecorder::Scope trace ("load state");
+
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
 
@@ -444,15 +1324,58 @@ void ChanceMachineAudioProcessor::setStateInformation (const void* data, int siz
         if (newState.hasProperty("version")) {
             // only replace if it's the same version of the tree (i.e. has same properties)
             if (newState.getProperty("version") == state.state.getProperty("version")) {
-                state.replaceState (newState);
+                // the pattern bank isn't part of the parameter state
+                auto programs = newState.getChildWithName ("Programs");
+                newState.removeChild (programs, nullptr);
+
+                {
+                    // so a program change can't store the old parameters into the new bank
+                    const juce::ScopedLock lock (programLock);
+                    restorePrograms (programs);
+                    state.replaceState (newState);
+                }
+
+                restoreConditionExpressions();
+                midiLearn.restore();
+
+                // if a midi out was previously open, open it as soon as the message thread gets to it
+                midiRouter.midiId = state.state.getProperty("savedMIDIId").toString();
+                oscSender.setPort (state.state.getProperty ("oscPort", 0));
+                midiRouter.setSharedOutput (state.state.getProperty ("sharedOut", false));
+                midiRouter.updateDeviceListAsync(true);
+            }
+        }
+    }
+
+}
 
-                // if a midi out was previously open, open it now
-                midiSelect.midiId = state.state.getProperty("savedMIDIId").toString();
-                midiSelect.updateDeviceList(true);
+
+void ChanceMachineAudioProcessor::restorePrograms (const juce::ValueTree& programs)
+{
+    programUsed.fill (false);
+
+    for (const auto& program : programs) {
+        auto index = static_cast<int>(program.getProperty ("index", -1));
+        if (index < 0 || index >= numPrograms) continue;
+
+        juce::MemoryBlock data;
+        auto& values = programBank[(size_t) index];
+
+        // programs saved before parameters were added are shorter - the new ones get their defaults
+        if (data.fromBase64Encoding (program.getProperty ("values").toString())
+            && data.getSize() <= sizeof (values) && data.getSize() % 2 == 0) {
+            for (size_t i=0; i<values.size(); i++) {
+                values[i] = i * 2 < data.getSize()
+                          ? juce::ByteOrder::littleEndianShort (static_cast<const char*>(data.getData()) + i * 2)
+                          : static_cast<juce::uint16>(juce::roundToInt (patternParameters[i]->getDefaultValue() * 65535.0f));
             }
+            programUsed[(size_t) index] = true;
         }
     }
 
+    // the parameters being restored are the current program's
+    currentProgram = juce::jlimit (0, numPrograms - 1, static_cast<int>(programs.getProperty ("current", 0)));
+    requestedProgram = -1;
 }
 
 
@@ -22,17 +22,33 @@
 class ChanceMachineAudioProcessor;
 
 #include <JuceHeader.h>
-#include "MIDIOutSelector.h"
+#include "MIDIOutputRouter.h"
+#include "MIDIOutputOptimiser.h"
+#include "TransportTracker.h"
+#include "MIDIClockFollower.h"
+#include "InternalTransport.h"
+#include "MIDIClockGenerator.h"
+#include "SequencerEngine.h"
+#include "ConditionExpression.h"
+#include "EventScheduler.h"
+#include "TripleBuffer.h"
+#include "StepLearner.h"
+#include "OSCEventSender.h"
+#include "TraceRecorder.h"
+#include "MIDITakeRecorder.h"
+#include "MIDILearnMap.h"
+#include "PatternOptions.h"
 
 //==============================================================================
 /**
 */
 class ChanceMachineAudioProcessor  :    public juce::AudioProcessor,
-                                    public juce::ChangeBroadcaster
+                                    public juce::ChangeBroadcaster,
+                                    private juce::AudioProcessorValueTreeState::Listener
 
 {
 public:
-    std::string extracted(int i);
+    static std::string extracted(int i);
     
 //==============================================================================
     ChanceMachineAudioProcessor();
@@ -76,35 +92,249 @@ public:
     juce::AudioProcessorValueTreeState state;
     bool initialised = false;
     
-    MIDIOutSelector midiSelect;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> midiSelectAttach;
+    MIDIOutputOptimiser midiOptimiser;
+    MIDIOutputRouter midiRouter;
 
     std::string statusMessage; // used for debugging
+
+    // events the scheduler had no room for (should always be 0)
+    int getNumDroppedEvents () const    { return droppedEvents.load (std::memory_order_relaxed); }
     
-    const juce::StringArray condition_options =
-        { "1:1", "1:2", "2:2", "1:4", "2:4", "3:4", "4:4",
-          "1:8", "2:8", "3:8", "4:8", "5:8", "6:8", "7:8", "8:8",
-          "1:16", "2:16", "3:16", "4:16", "5:16", "6:16", "7:16", "8:16",
-          "9:16", "10:16", "11:16", "12:16", "13:16", "14:16", "15:16", "16:16"};
-
-    const juce::StringArray stepLength_options =
-        { "1 Bar", "1 / 2", "1 / 4", "1 / 8", "1 / 16" };
-    
-    const std::map<juce::String, int> stepLength_values =
-        { {"1 Bar", 1}, {"1 / 2", 2}, {"1 / 4", 4}, {"1 / 8", 8}, {"1 / 16", 16} };
+    // option lists are shared by all instances, so they're only built once. The ones
+    // for the pattern itself are in PatternOptions.h, as the command line tools need them too
+    static inline const juce::StringArray& condition_options = PatternOptions::condition_options;
+    static inline const juce::StringArray& stepLength_options = PatternOptions::stepLength_options;
+    static inline const std::vector<std::pair<int, int>>& condition_values = PatternOptions::condition_values;
+    static inline const std::map<juce::String, int>& stepLength_values = PatternOptions::stepLength_values;
+    static inline const juce::StringArray& ratchet_options = PatternOptions::ratchet_options;
+    static inline const juce::StringArray& dependency_options = PatternOptions::dependency_options;
+    static inline const juce::StringArray& reset_options = PatternOptions::reset_options;
+
+    // pattern changes are applied at the next step, bar or pattern reset
+    static inline const juce::StringArray patternSync_options =
+        { "Step", "Bar", "Reset" };
+
+    // maximum number of MIDI messages per second sent to each output (0 = no limit)
+    static inline const juce::StringArray midiRate_options =
+        { "No limit", "1000 / s", "500 / s", "250 / s", "100 / s" };
+
+    static inline const std::vector<int> midiRate_values = { 0, 1000, 500, 250, 100 };
+
+    // time signatures for the standalone transport, and beats per bar / beat length for each of them
+    static inline const juce::StringArray timeSignature_options =
+        { "4 / 4", "3 / 4", "5 / 4", "7 / 4", "6 / 8", "7 / 8", "9 / 8", "12 / 8" };
+
+    static inline const std::vector<std::pair<int, int>> timeSignature_values = [] {
+        std::vector<std::pair<int, int>> values;
+        for (auto& t : timeSignature_options) {
+            values.push_back ({ t.upToFirstOccurrenceOf ("/", false, false).getIntValue(),
+                                t.fromFirstOccurrenceOf ("/", false, false).getIntValue() });
+        }
+        return values;
+    }();
+
+    static inline const juce::StringArray CC_options = [] {
+        juce::StringArray options;
+        for (auto i=0; i<=127; i++) options.add("CC " + std::to_string(i));
+        return options;
+    }();
+
+    // names of the patterns in the bank (one for each program)
+    static inline const juce::StringArray program_options = [] {
+        juce::StringArray options;
+        for (auto i=1; i<=128; i++) options.add("Pattern " + std::to_string(i));
+        return options;
+    }();
+
+    static inline const juce::StringArray channel_options = [] {
+        juce::StringArray options;
+        for (auto i=1; i<=16; i++) options.add(std::to_string(i));
+        return options;
+    }();
 
-    const juce::StringArray reset_options =
-        { "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15", "16"};
+    // number of external MIDI outputs that can be picked with the 'midiSelect' parameter
+    static constexpr int maxMidiOutputs = MIDIOutputRouter::maxSelectableDevices;
+
+    static inline const juce::StringArray midiSelect_options = [] {
+        juce::StringArray options ("To Host");
+        for (auto i=1; i<=maxMidiOutputs; i++) options.add("Output " + std::to_string(i));
+        return options;
+    }();
+
+    // text for the values shown in percent (-100 to 100). Hosts and controller displays
+    // ask for parameter text all the time, so it's made once here and then only shared
+    // (copying a juce::String doesn't allocate anything)
+    static inline const juce::StringArray percent_texts = [] {
+        juce::StringArray texts;
+        for (auto i=-100; i<=100; i++) texts.add(std::to_string(i));
+        return texts;
+    }();
+
+    static juce::String getPercentText (int percent)    { return percent_texts[juce::jlimit (-100, 100, percent) + 100]; }
+
+    juce::String getMidiOutputName (int index) const;
 
     int currentStep = 0;
+
+    // learns chances and conditions from the notes coming in (in 'Forward host note' mode)
+    StepLearner stepLearner;
+    void applyLearnedPattern();
+
+    // message thread: writes the current pattern to an XML file, the same as the saved
+    // state - which is what the command line tools read (see PatternFile.h)
+    bool exportPattern (const juce::File& file) const;
+
+    // trigger conditions typed in as expressions (e.g. "!1:4 & !fill"), used instead of
+    // the step's condition parameter. An empty expression goes back to the parameter.
+    bool setConditionExpression (int step, const juce::String& text, juce::String& error);
+    juce::String getConditionExpression (int step) const;
+
+    // records everything that's sent out to a MIDI file
+    MIDITakeRecorder takeRecorder;
+
+    // incoming CCs mapped to the chances, conditions, step length and reset
+    MIDILearnMap midiLearn { state };
+
+    // send steps and triggers as OSC to a local port (0 = off)
+    void setOscPort (int port);
+    int getOscPort () const         { return oscSender.getPort(); }
     
     
 
 private:
     //==============================================================================
+    juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    static constexpr int numSteps = 16;
+    using Engine = SequencerEngine<numSteps>;
+
+    // the pattern is built on the message thread and handed over to the audio thread
+    // (when rendering offline, the audio thread builds it itself, so a bounce always
+    // changes pattern at the same place, however busy the message thread is)
+    struct PatternSnapshot
+    {
+        Engine::Pattern pattern;
+        bool stepIsBar = false;     // the length of a bar depends on the host's time signature
+        int program = 0;            // the program it belongs to - a different one waits for the next bar
+    };
+
+    bool patternStepIsBar = false;
+    TripleBuffer<PatternSnapshot> patternSnapshots;
+    PatternSnapshot nextPattern;                // the latest pattern from the message thread...
+    bool patternPending = false;                // ...waiting for the next boundary
+    int playingProgram = 0;                     // the program the playing pattern belongs to
+    std::atomic<bool> patternDirty { false };   // a setting changed, so the pattern needs building again
+
+    // one timer for all instances picks up the changes on the message thread
+    class ChangePoller;
+    juce::SharedResourcePointer<ChangePoller> changePoller;
+
+    // bank of patterns, switched with program changes. Each one is a copy of the
+    // pattern parameters (as 16 bit values), kept in the order they're created in
+    // (so new pattern parameters have to be created last, see restorePrograms).
+    // Program changes use it on the message thread, while hosts save and load the
+    // state from whichever thread they like, so it's only touched under programLock.
+    static constexpr int numPrograms = 128;
+    static constexpr int numPatternParameters = numSteps * 4 + 5;
+
+    std::array<juce::RangedAudioParameter*, numPatternParameters> patternParameters {};
+    std::array<std::array<juce::uint16, numPatternParameters>, numPrograms> programBank {};
+    std::array<bool, numPrograms> programUsed {};
+    juce::CriticalSection programLock;
+    std::atomic<int> currentProgram { 0 };
+    std::atomic<int> requestedProgram { -1 };
+
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void pollChanges ();
+    void handleProgramChange ();
+    static bool isPatternParameter (const juce::String& paramID);
+    void buildPattern (PatternSnapshot& snapshot) const;
+    void publishPattern ();
+    void storeProgram (int program);
+    void loadProgram (int program);
+    void restorePrograms (const juce::ValueTree& programs);
+    void restoreConditionExpressions ();
+    void applyNextPattern (double qnotes_per_bar);
+    int findPatternBoundary (const SequencerTimeline& span, double qnotes_per_bar) const;
+
+    void sendStepCC (juce::MidiBuffer& midiMessages, int sendOut, int channel, int CC, int samplePosition);
+    static bool isClockMessage (const juce::uint8* data);
+    void forwardMidi (juce::MidiBuffer& output, const juce::uint8* data, int numBytes, int samplePosition,
+                      int channel, bool toOutputs);
+
+    // anything that has to happen at a later time than it was worked out
+    // (shifted steps, ratchets, delayed notes) goes through the scheduler
+    struct ScheduledEvent
+    {
+        enum class Type : juce::uint8 { step, ratchet, retrigger, learn, message };
+
+        Type type = Type::message;
+        bool on = false;                    // step, ratchet: whether the step is on
+        juce::int16 step = 0;               // step, learn: which step this is
+        juce::int32 cycle = 0;              // step, learn: which cycle of the pattern the step is in
+        juce::int32 length = 0;             // step: how late notes are played, retrigger: how long they're held (in samples)
+        juce::uint8 numBytes = 0;           // message: the raw MIDI message
+        std::array<juce::uint8, 3> bytes {};
+    };
+
+    void scheduleStep (const SequencerEvent& event, const SequencerTimeline& timeline, juce::int64 blockStart, int sendOut);
+    bool schedule (juce::int64 time, const ScheduledEvent& event);
+    bool scheduleMessage (juce::int64 time, const juce::MidiMessage& message);
+    void handleScheduledEvent (juce::int64 time, const ScheduledEvent& event, juce::MidiBuffer& output,
+                               juce::int64 blockStart, int sendOut, int channel, int CC);
+    void sendMidi (juce::MidiBuffer& output, const juce::MidiMessage& message, int samplePosition);
+    double getEventTimeMs (int samplePosition) const;
 
-    int previous_steps = 0;
     bool step_on = true;
+    bool step_changed = false;
+
+    TransportTracker transport;
+    MIDIClockFollower midiClock;
+    InternalTransport internalTransport;
+    MIDIClockGenerator clockGenerator;
+    juce::MidiBuffer clockMessages;
+    juce::MidiBuffer forwardedMidi;                     // kept between blocks, so forwarding doesn't allocate
+    Engine engine { static_cast<std::uint64_t> (juce::Time::getHighResolutionTicks()) };
+    Engine::Pattern pattern;
+    std::array<SequencerEvent, 64> stepEvents;
+
+    EventScheduler<ScheduledEvent, 1024> scheduler;
+    std::atomic<int> droppedEvents { 0 };
+    juce::int64 sampleClock = 0;                        // samples played since prepareToPlay
+    int noteDelay = 0;                                  // how late incoming notes are played in the current step
+    std::array<juce::int64, 128> noteOnTimes {};        // when each note was last played, so note-offs don't overtake them
+    std::array<std::pair<int, juce::uint8>, 16> stepNotes;   // notes played in the current step, for ratchets
+    int numStepNotes = 0;
+
+    OSCEventSender oscSender;
+    double oscClockOffsetMs = 0;                        // from the hi-res counter to the wall clock
+    double oscBlockStartMs = 0;
+
+    std::array<std::atomic<float>*, numSteps> chanceValues;
+    std::array<std::atomic<float>*, numSteps> conditionValues;
+    std::array<std::atomic<float>*, numSteps> timingValues;
+    std::array<std::atomic<float>*, numSteps> ratchetValues;
+
+    // compiled. Set from the message thread and from setStateInformation, and read by
+    // buildPattern (which runs on the audio thread when rendering offline)
+    std::array<SequencerCondition, numSteps> conditionExpressions;
+    mutable juce::SpinLock conditionExpressionsLock;
+
+    std::atomic<float>* fillValue = nullptr;
+    std::atomic<float>* swingValue = nullptr;
+    std::atomic<float>* dependencyValue = nullptr;
+    std::atomic<float>* dependencyAmountValue = nullptr;
+    std::atomic<float>* patternSyncValue = nullptr;
+    std::atomic<float>* stepLengthValue = nullptr;
+    std::atomic<float>* resetValue = nullptr;
+    std::atomic<float>* sendOutValue = nullptr;
+    std::atomic<float>* CCValue = nullptr;
+    std::atomic<float>* channelValue = nullptr;
+    std::atomic<float>* midiRateValue = nullptr;
+    std::atomic<float>* clockOutValue = nullptr;
+    std::atomic<float>* playValue = nullptr;
+    std::atomic<float>* tempoValue = nullptr;
+    std::atomic<float>* timeSignatureValue = nullptr;
 
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChanceMachineAudioProcessor)
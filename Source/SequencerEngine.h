@@ -0,0 +1,494 @@
+/*
+  ==============================================================================
+
+    SequencerEngine.h
+    Created: 18 Oct 2026 2:05:48pm
+    Author:  Boris Divjak
+
+    The probability sequencer itself, without any JUCE parameters or MIDI
+    I/O. It takes a plain snapshot of the pattern and a span of the
+    timeline, and writes one event per lane for every step that starts
+    within that span into a buffer supplied by the caller.
+
+    Step and lane counts are template arguments, so the loops over them
+    have fixed trip counts the compiler can unroll. Nothing the engine
+    runs allocates or locks, so it's safe to run on the audio thread, and
+    the same code can be used by offline tools (which is where working
+    out a pattern's expected rates belongs).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+//==============================================================================
+
+
+// A trigger condition written as an expression (e.g. "!1:4 & !fill"), compiled on
+// the message thread into a tiny program (see ConditionExpression). The program
+// works on a stack of bits and is never longer than maxLength, so evaluating it
+// takes the same short time for every step.
+struct SequencerCondition
+{
+    enum Op : std::uint8_t
+    {
+        end = 0,
+        cycleOf,        // followed by A and B: this is the A-th out of every B cycles
+        previous,       // the step before this one fired
+        firstCycle,     // the first cycle of the pattern
+        fill,           // the fill switch is on
+        negate,
+        both,
+        either
+    };
+
+    static constexpr int maxLength = 24;
+    static constexpr int maxDepth = 32;
+
+    std::array<std::uint8_t, maxLength> code {};
+
+    bool isEmpty () const noexcept      { return code[0] == end; }
+
+    bool evaluate (std::int64_t cycle, bool previousFired, bool fillOn) const noexcept
+    {
+        std::uint32_t stack = 0;    // top of the stack is the lowest bit
+
+        for (int i = 0; i < maxLength && code[(std::size_t) i] != end; ++i)
+        {
+            std::uint32_t bit = 0;
+
+            switch (code[(std::size_t) i])
+            {
+                case cycleOf:
+                {
+                    if (i + 2 >= maxLength) return false;
+                    auto a = static_cast<std::int64_t> (code[(std::size_t) i + 1]);
+                    auto b = static_cast<std::int64_t> (code[(std::size_t) i + 2] > 0 ? code[(std::size_t) i + 2] : 1);
+                    bit = (cycle % b + b) % b + 1 == a;
+                    i += 2;
+                    break;
+                }
+                case previous:      bit = previousFired; break;
+                case firstCycle:    bit = cycle == 0; break;
+                case fill:          bit = fillOn; break;
+                case negate:        stack ^= 1u; continue;
+                case both:          stack = (stack >> 1) & (stack | ~1u); continue;
+                case either:        stack = (stack >> 1) | (stack & 1u); continue;
+                default:            return false;
+            }
+
+            stack = (stack << 1) | bit;
+        }
+
+        return (stack & 1u) != 0;
+    }
+};
+
+
+//==============================================================================
+
+
+// Plain copyable snapshot of everything the engine needs to know about a pattern
+template <int NumSteps, int NumLanes = 1>
+struct SequencerPattern
+{
+    static constexpr int numSteps = NumSteps;
+    static constexpr int numLanes = NumLanes;
+
+    struct Step
+    {
+        float chance = 1.0f;            // 0 to 1
+        std::uint8_t conditionA = 1;    // fire on the A-th ...
+        std::uint8_t conditionB = 1;    // ... out of every B cycles
+        std::uint8_t ratchets = 1;      // number of times the step is played
+        float offset = 0.0f;            // timing, as a fraction of a step (-0.5 to 0.5)
+        SequencerCondition expression;  // used instead of A and B, if there is one
+
+        // the chance to use when steps depend on each other, indexed by whether the step
+        // before fired (+1) and whether this step fired in the last cycle (+2)
+        std::array<float, 4> chanceAfter { 1.0f, 1.0f, 1.0f, 1.0f };
+    };
+
+    // whether a step's chance depends on what happened before it
+    enum class Dependency : std::uint8_t { none, previousStep, previousStepAndCycle };
+
+    std::array<std::array<Step, NumSteps>, NumLanes> steps {};
+    Dependency dependency = Dependency::none;
+
+    double stepsPerQuarterNote = 4.0;   // 4 = sixteenth notes, 2 = eighth notes etc.
+    int reset = NumSteps;               // return to the first step after this many steps
+    float swing = 0.0f;                 // delay of every other step, as a fraction of a step
+
+    // how often each step of a lane should fire in the long run (0 to 1): its chance, times
+    // the share of cycles its condition lets through, moved by whatever it depends on.
+    // Without fills and after the first cycle. It follows the lane through 16 cycles at a
+    // time (the longest condition) until it settles, so it's not for the audio thread.
+    std::array<double, NumSteps> getExpectedRates (int lane) const
+    {
+        auto length = (reset > 0 && reset <= NumSteps) ? reset : NumSteps;
+
+        // when steps depend on their own last cycle as well as the step before, those two
+        // aren't independent, so every combination of steps in the last cycle is followed
+        if (dependency == Dependency::previousStepAndCycle && length <= 16)
+            return getExpectedRatesFromCycles (lane, length);
+
+        // otherwise the chance that the step before fired is all that's needed
+        std::array<double, NumSteps> rates {}, lastRates {};
+        auto previousOn = 1.0;      // the engine starts with the step before on
+
+        for (int pass = 0; pass < maxExpectedPasses && (pass < 2 || ! hasSettled (rates, lastRates)); ++pass)
+        {
+            lastRates = rates;
+            rates = {};
+
+            for (int cycle = numExpectedCycles; cycle < numExpectedCycles * 2; ++cycle)
+            {
+                for (int i = 0; i < length; ++i)
+                {
+                    auto& s = steps[(std::size_t) lane][(std::size_t) i];
+                    auto on = previousOn * getOnChance (s, cycle, true, false)
+                            + (1.0 - previousOn) * getOnChance (s, cycle, false, false);
+
+                    previousOn = on;
+                    rates[(std::size_t) i] += on / numExpectedCycles;
+                }
+            }
+        }
+
+        return rates;
+    }
+
+    double getExpectedRate (int lane, int step) const
+    {
+        return step >= 0 && step < NumSteps ? getExpectedRates (lane)[(std::size_t) step] : 0.0;
+    }
+
+    // works out chanceAfter for every step. Amount goes from -1 (a step is as unlikely as
+    // possible after a hit) to 1 (as likely as possible), and each step still fires as
+    // often as its chance says in the long run (if the one before it fires as often as its
+    // chance says). Even at -1 and 1 a step never becomes certain to fire or not, as a lane
+    // would then get stuck always on (or off). The step before the first one is the last
+    // one before the reset. Call this after changing the chances or the reset - it's not
+    // for the audio thread.
+    void setDependency (Dependency newDependency, float amount) noexcept
+    {
+        dependency = newDependency;
+        amount = amount < -1.0f ? -1.0f : (amount > 1.0f ? 1.0f : amount);
+        auto length = (reset > 0 && reset <= NumSteps) ? reset : NumSteps;
+
+        for (auto& lane : steps)
+        {
+            for (int i = 0; i < NumSteps; ++i)
+            {
+                auto& s = lane[(std::size_t) i];
+                auto p = clampChance (s.chance);
+                auto before = clampChance (lane[(std::size_t) ((i + length - 1) % length)].chance);
+
+                // split p into a chance after a hit and after a miss of the step before
+                auto afterMiss = 0.0, afterHit = 0.0;
+                split (p, before, amount, afterMiss, afterHit);
+
+                // then split each of those again by this step's own last cycle
+                auto useCycle = newDependency == Dependency::previousStepAndCycle;
+                double missMiss = afterMiss, missHit = afterMiss, hitMiss = afterHit, hitHit = afterHit;
+
+                if (useCycle) {
+                    split (afterMiss, p, amount, missMiss, missHit);
+                    split (afterHit, p, amount, hitMiss, hitHit);
+                }
+
+                s.chanceAfter = { static_cast<float> (missMiss), static_cast<float> (hitMiss),
+                                  static_cast<float> (missHit), static_cast<float> (hitHit) };
+            }
+        }
+    }
+
+    // how far from the grid a step is played, as a fraction of a step
+    double getTimingOffset (int lane, int step) const noexcept
+    {
+        auto offset = static_cast<double> (steps[(std::size_t) lane][(std::size_t) step].offset);
+        return (step % 2 == 1) ? offset + swing : offset;
+    }
+
+private:
+    static constexpr int numExpectedCycles = 16;
+    static constexpr double maxCoupling = 0.9;
+    static constexpr int maxExpectedPasses = 256;
+
+    static bool hasSettled (const std::array<double, NumSteps>& rates, const std::array<double, NumSteps>& lastRates) noexcept
+    {
+        for (std::size_t i = 0; i < rates.size(); ++i)
+            if (std::abs (rates[i] - lastRates[i]) > 1.0e-9)
+                return false;
+
+        return true;
+    }
+
+    static double clampChance (float chance) noexcept
+    {
+        return static_cast<double> (chance < 0.0f ? 0.0f : (chance > 1.0f ? 1.0f : chance));
+    }
+
+    // the chance a step fires in a cycle, given whether the step before fired and whether it fired last cycle
+    double getOnChance (const Step& s, int cycle, bool previous, bool last) const noexcept
+    {
+        auto allowed = s.expression.isEmpty()
+                        ? s.conditionB <= 1 || cycle % s.conditionB + 1 == s.conditionA
+                        : s.expression.evaluate (cycle, previous, false);
+
+        if (! allowed)
+            return 0.0;
+
+        return clampChance (dependency == Dependency::none ? s.chance
+                                                           : s.chanceAfter[(std::size_t) ((previous ? 1 : 0) + (last ? 2 : 0))]);
+    }
+
+    // follows the chance of every combination of steps having fired in the last cycle (one bit
+    // per step). The step before is always the bit below, so that's all there is to know.
+    std::array<double, NumSteps> getExpectedRatesFromCycles (int lane, int length) const
+    {
+        std::array<double, NumSteps> rates {}, lastRates {};
+        std::vector<double> combinations ((std::size_t) 1 << length, 0.0);
+
+        // the engine starts with no step on in the last cycle, but with the step before on
+        combinations[0] = 1.0;
+        auto firstStep = true;
+
+        for (int pass = 0; pass < maxExpectedPasses && (pass < 2 || ! hasSettled (rates, lastRates)); ++pass)
+        {
+            lastRates = rates;
+            rates = {};
+
+            for (int cycle = numExpectedCycles; cycle < numExpectedCycles * 2; ++cycle)
+            {
+                for (int i = 0; i < length; ++i)
+                {
+                    auto& s = steps[(std::size_t) lane][(std::size_t) i];
+                    auto bit = (std::size_t) 1 << i;
+                    auto previousBit = (std::size_t) 1 << ((i + length - 1) % length);
+
+                    const double onAfter[4] = { getOnChance (s, cycle, false, false), getOnChance (s, cycle, true, false),
+                                                getOnChance (s, cycle, false, true),  getOnChance (s, cycle, true, true) };
+                    auto on = 0.0;
+
+                    // this step's bit is replaced by whether it fires this time
+                    for (std::size_t off = 0; off < combinations.size(); ++off)
+                    {
+                        if ((off & bit) != 0)
+                            continue;
+
+                        auto wasOn = off | bit;
+                        auto fromOff = combinations[off] * onAfter[firstStep || (off & previousBit) != 0 ? 1 : 0];
+                        auto fromOn = combinations[wasOn] * onAfter[firstStep || (wasOn & previousBit) != 0 ? 3 : 2];
+
+                        combinations[off] += combinations[wasOn] - fromOff - fromOn;
+                        combinations[wasOn] = fromOff + fromOn;
+                        on += fromOff + fromOn;
+                    }
+
+                    firstStep = false;
+                    rates[(std::size_t) i] += on / numExpectedCycles;
+                }
+            }
+        }
+
+        return rates;
+    }
+
+    // chance p after something that happens with chance q, moved as far as amount
+    // allows while keeping q * afterHit + (1 - q) * afterMiss = p
+    static void split (double p, double q, float amount, double& afterMiss, double& afterHit) noexcept
+    {
+        auto limit = 0.0;
+
+        if (amount > 0.0f)          limit = std::fmin (q < 1.0 ? (1.0 - p) / (1.0 - q) : 0.0, q > 0.0 ? p / q : 0.0);
+        else if (amount < 0.0f)     limit = std::fmin (q < 1.0 ? p / (1.0 - q) : 0.0, q > 0.0 ? (1.0 - p) / q : 0.0);
+
+        // only most of the way to the limit, which would make one of them 0 or 1
+        auto k = amount * limit * maxCoupling;
+        afterHit = std::fmin (1.0, std::fmax (0.0, p + k * (1.0 - q)));
+        afterMiss = std::fmin (1.0, std::fmax (0.0, p - k * q));
+    }
+};
+
+
+// The part of the timeline covered by one block
+struct SequencerTimeline
+{
+    double ppqStart = 0.0;      // position of the first sample, in quarter notes
+    double ppqPerSample = 0.0;  // 0 if time isn't moving
+    int numSamples = 0;
+    bool playing = true;
+};
+
+
+struct SequencerEvent
+{
+    int samplePosition;
+    int lane;
+    int step;
+    std::int64_t cycle;
+    double ppq;         // where the step starts on the timeline
+    bool fired;
+};
+
+
+//==============================================================================
+
+
+// Small, fast and seedable random number generator (xorshift64*)
+class SequencerRandom
+{
+public:
+    explicit SequencerRandom (std::uint64_t seed = 0x9e3779b97f4a7c15ull) noexcept    { setSeed (seed); }
+
+    void setSeed (std::uint64_t seed) noexcept
+    {
+        // run the seed through splitmix64, so that similar seeds give unrelated sequences
+        seed += 0x9e3779b97f4a7c15ull;
+        seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+        seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+        state = (seed ^ (seed >> 31)) | 1;
+    }
+
+    std::uint64_t next () noexcept
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dull;
+    }
+
+    // uniform in [0, 1)
+    float nextFloat () noexcept     { return static_cast<float> (next() >> 40) * (1.0f / 16777216.0f); }
+
+private:
+    std::uint64_t state = 1;
+};
+
+
+//==============================================================================
+
+
+template <int NumSteps, int NumLanes = 1>
+class SequencerEngine
+{
+public:
+    using Pattern = SequencerPattern<NumSteps, NumLanes>;
+
+    static constexpr int numSteps = NumSteps;
+    static constexpr int numLanes = NumLanes;
+
+    explicit SequencerEngine (std::uint64_t seed = 0x9e3779b97f4a7c15ull) noexcept : random (seed) {}
+
+    void setSeed (std::uint64_t seed) noexcept      { random.setSeed (seed); }
+
+    // the fill switch, for conditions that use it
+    void setFill (bool shouldFill) noexcept         { fill = shouldFill; }
+
+    // forget the last evaluated step, so the next block evaluates the step it starts on
+    void reset () noexcept                          { lastStepIndex = noStep; }
+
+    int getCurrentStep () const noexcept            { return currentStep; }
+    bool isStepOn (int lane = 0) const noexcept     { return stepOn[(std::size_t) lane]; }
+
+    //==============================================================================
+    // Evaluates every step that starts within the timeline span (plus the step
+    // the span starts on, if it hasn't been evaluated yet) and returns the
+    // number of events written. Events are in time order.
+    int process (const Pattern& pattern, const SequencerTimeline& timeline,
+                 SequencerEvent* events, int maxEvents) noexcept
+    {
+        auto numEvents = 0;
+        auto stepsPerQuarterNote = pattern.stepsPerQuarterNote;
+
+        if (! timeline.playing || stepsPerQuarterNote <= 0.0 || timeline.numSamples <= 0)
+            return 0;
+
+        auto firstIndex = static_cast<std::int64_t> (std::floor (timeline.ppqStart * stepsPerQuarterNote));
+
+        if (firstIndex != lastStepIndex)
+            numEvents = evaluate (pattern, firstIndex, 0, events, numEvents, maxEvents);
+
+        if (timeline.ppqPerSample <= 0.0)
+            return numEvents;
+
+        auto ppqEnd = timeline.ppqStart + timeline.ppqPerSample * timeline.numSamples;
+        auto lastIndex = static_cast<std::int64_t> (std::floor (ppqEnd * stepsPerQuarterNote));
+
+        for (auto index = firstIndex + 1; index <= lastIndex; ++index)
+        {
+            auto offset = (static_cast<double> (index) / stepsPerQuarterNote - timeline.ppqStart) / timeline.ppqPerSample;
+            auto samplePosition = offset <= 0.0 ? 0 : static_cast<int> (std::ceil (offset));
+
+            // a step starting exactly at the end belongs to the next block
+            if (samplePosition >= timeline.numSamples)
+                break;
+
+            numEvents = evaluate (pattern, index, samplePosition, events, numEvents, maxEvents);
+        }
+
+        return numEvents;
+    }
+
+private:
+    static constexpr std::int64_t noStep = std::numeric_limits<std::int64_t>::min();
+
+    int evaluate (const Pattern& pattern, std::int64_t index, int samplePosition,
+                  SequencerEvent* events, int numEvents, int maxEvents) noexcept
+    {
+        auto reset = static_cast<std::int64_t> (pattern.reset > 0 && pattern.reset <= NumSteps ? pattern.reset : NumSteps);
+
+        // floor division, so that steps before the start of the timeline still count properly
+        auto cycle = index / reset;
+        if (index % reset < 0) --cycle;
+        auto step = static_cast<int> (index - cycle * reset);
+        auto ppq = static_cast<double> (index) / pattern.stepsPerQuarterNote;
+
+        for (int lane = 0; lane < NumLanes; ++lane)
+        {
+            auto& s = pattern.steps[(std::size_t) lane][(std::size_t) step];
+
+            // only turn on every A out of B cycles (or whenever the expression says so)
+            auto on = s.expression.isEmpty()
+                        ? s.conditionB <= 1 || (cycle % s.conditionB + s.conditionB) % s.conditionB + 1 == s.conditionA
+                        : s.expression.evaluate (cycle, stepOn[(std::size_t) lane], fill);
+
+            // the chance may depend on the step before, and on this step in the last cycle
+            auto chance = s.chance;
+
+            if (pattern.dependency != Pattern::Dependency::none) {
+                auto context = (stepOn[(std::size_t) lane] ? 1 : 0) + (lastCycleOn[(std::size_t) lane][(std::size_t) step] ? 2 : 0);
+                chance = s.chanceAfter[(std::size_t) context];
+            }
+
+            // always roll, so the random sequence doesn't depend on the conditions
+            if (random.nextFloat() >= chance)
+                on = false;
+
+            stepOn[(std::size_t) lane] = on;
+            lastCycleOn[(std::size_t) lane][(std::size_t) step] = on;
+
+            if (numEvents < maxEvents)
+                events[numEvents++] = { samplePosition, lane, step, cycle, ppq, on };
+        }
+
+        lastStepIndex = index;
+        currentStep = step;
+        return numEvents;
+    }
+
+    SequencerRandom random;
+    std::int64_t lastStepIndex = noStep;
+    int currentStep = 0;
+    bool fill = false;
+    std::array<std::array<bool, NumSteps>, NumLanes> lastCycleOn {};
+    std::array<bool, NumLanes> stepOn = [] { std::array<bool, NumLanes> a {}; a.fill (true); return a; }();
+};
@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    SharedEventRing.cpp
+    Created: 19 Oct 2026 11:03:10am
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "SharedEventRing.h"
+
+
+SharedEventRing::~SharedEventRing()
+{
+    close();
+}
+
+
+juce::MidiMessage SharedEventRing::Event::getMessage (double timeStamp) const
+{
+    return juce::MidiMessage (bytes.data(), juce::jlimit (1, 3, (int) numBytes), timeStamp);
+}
+
+
+juce::File SharedEventRing::getRingFile (int number)
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                .getChildFile ("ChanceMachine")
+                .getChildFile ("ring" + juce::String (number) + ".events");
+}
+
+
+//==============================================================================
+
+
+bool SharedEventRing::create ()
+{
+    close();
+
+    for (auto number = 1; number <= maxRings; ++number)
+    {
+        // whoever holds the lock is the ring's writer
+        auto lock = std::make_unique<juce::InterProcessLock> ("ChanceMachineRing" + juce::String (number));
+        if (! lock->enter (0)) continue;
+
+        // make sure the file is big enough, but never shrink it (readers may still have it mapped)
+        auto file = getRingFile (number);
+        file.getParentDirectory().createDirectory();
+
+        if (file.getSize() < (juce::int64) fileSize) {
+            juce::FileOutputStream stream (file);
+            if (! stream.openedOk()) continue;
+            stream.writeRepeatedByte (0, fileSize - (size_t) stream.getPosition());
+        }
+
+        if (! map (number, juce::MemoryMappedFile::readWrite)) continue;
+
+        // start again from scratch - readers notice the count going back and catch up
+        writeCount = 0;
+        header->writeCount.store (0, std::memory_order_relaxed);
+        for (auto i = 0; i < capacity; ++i)
+            slots[i].sequence.store (0, std::memory_order_relaxed);
+
+        header->capacity = (juce::uint32) capacity;
+        header->version = ringVersion;
+        header->writerActive.store (1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        header->magic = ringMagic;
+
+        writerLock = std::move (lock);
+        return true;
+    }
+
+    return false;
+}
+
+
+void SharedEventRing::close ()
+{
+    if (header != nullptr && writerLock != nullptr)
+        header->writerActive.store (0, std::memory_order_release);
+
+    header = nullptr;
+    slots = nullptr;
+    mappedFile.reset();
+    writerLock.reset();
+    ringNumber = 0;
+}
+
+
+bool SharedEventRing::map (int number, juce::MemoryMappedFile::AccessMode mode)
+{
+    mappedFile = std::make_unique<juce::MemoryMappedFile> (getRingFile (number), juce::Range<juce::int64> (0, (juce::int64) fileSize), mode);
+
+    if (mappedFile->getData() == nullptr || mappedFile->getSize() < fileSize) {
+        mappedFile.reset();
+        return false;
+    }
+
+    header = static_cast<Header*> (mappedFile->getData());
+    slots = reinterpret_cast<Slot*> (header + 1);
+    ringNumber = number;
+    return true;
+}
+
+
+//==============================================================================
+
+
+void SharedEventRing::publish (const juce::MidiBuffer& buffer, double blockStartMs, double sampleRate) noexcept
+{
+    if (header == nullptr || sampleRate <= 0) return;
+
+    for (const auto metadata : buffer)
+    {
+        if (metadata.numBytes > 3) continue;
+
+        auto& slot = slots[writeCount & (capacity - 1)];
+
+        // mark the slot as being written, so readers don't use half of an old event
+        slot.sequence.store (writeCount * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        slot.timeMs = blockStartMs + metadata.samplePosition * 1000.0 / sampleRate;
+        slot.numBytes = (juce::uint8) metadata.numBytes;
+        std::copy (metadata.data, metadata.data + metadata.numBytes, slot.bytes);
+
+        slot.sequence.store (writeCount * 2 + 2, std::memory_order_release);
+        header->writeCount.store (++writeCount, std::memory_order_release);
+    }
+}
+
+
+//==============================================================================
+
+
+bool SharedEventRing::openForReading (int number)
+{
+    close();
+
+    if (! map (number, juce::MemoryMappedFile::readOnly))
+        return false;
+
+    if (header->magic != ringMagic || header->version != ringVersion || header->capacity != (juce::uint32) capacity) {
+        close();
+        return false;
+    }
+
+    // only pick up what's published from now on
+    readCount = header->writeCount.load (std::memory_order_acquire);
+    numLost = 0;
+    return true;
+}
+
+
+int SharedEventRing::read (Event* dest, int maxEvents) noexcept
+{
+    if (header == nullptr) return 0;
+
+    auto written = header->writeCount.load (std::memory_order_acquire);
+
+    // the writer started again
+    if (written < readCount)
+        readCount = written;
+
+    // anything more than a whole ring behind is gone already
+    if (written - readCount > (juce::uint64) capacity) {
+        numLost += written - readCount - (juce::uint64) capacity;
+        readCount = written - (juce::uint64) capacity;
+    }
+
+    auto numRead = 0;
+
+    for (; numRead < maxEvents && readCount < written; ++readCount)
+    {
+        auto& slot = slots[readCount & (capacity - 1)];
+        auto expected = readCount * 2 + 2;
+
+        auto before = slot.sequence.load (std::memory_order_acquire);
+
+        Event event;
+        event.timeMs = slot.timeMs;
+        event.numBytes = slot.numBytes;
+        std::copy (slot.bytes, slot.bytes + 3, event.bytes.begin());
+
+        std::atomic_thread_fence (std::memory_order_acquire);
+        auto after = slot.sequence.load (std::memory_order_relaxed);
+
+        // overwritten before (or while) we got to it
+        if (before != expected || after != expected) {
+            ++numLost;
+            continue;
+        }
+
+        dest[numRead++] = event;
+    }
+
+    return numRead;
+}
+
+
+bool SharedEventRing::hasWriter () const noexcept
+{
+    return header != nullptr && header->writerActive.load (std::memory_order_acquire) != 0;
+}
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    SharedEventRing.h
+    Created: 19 Oct 2026 11:02:45am
+    Author:  Boris Divjak
+
+    Passes timestamped MIDI events to other programs on the same computer
+    through shared memory, without going through the OS MIDI server (and
+    without having to set up a virtual MIDI device). Each plugin instance
+    writes to a ring of its own, numbered from 1, and any number of
+    readers can follow it.
+
+    The ring is a memory mapped file. The writer never waits for anyone -
+    it just overwrites the oldest events. Each slot works like a seqlock:
+    the writer copies the event into the slot between two updates of its
+    sequence number, and a reader copies it out again and checks the
+    sequence number didn't change while it was doing that. So it isn't
+    zero-copy - every event is copied in once and out once by each reader
+    (16 bytes each way) - it just skips the MIDI server and its thread hops.
+    ChanceTests compares the latency with sending to a MIDI device.
+
+    Times are in milliseconds of juce::Time::getMillisecondCounterHiRes(),
+    which is the same clock in every process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class SharedEventRing
+{
+public:
+    SharedEventRing() = default;
+    ~SharedEventRing();
+
+    static constexpr int maxRings = 16;
+    static constexpr int capacity = 4096;      // events (must be a power of 2)
+
+    struct Event
+    {
+        double timeMs = 0;                      // when the message should be played
+        juce::uint8 numBytes = 0;
+        std::array<juce::uint8, 3> bytes {};
+
+        juce::MidiMessage getMessage (double timeStamp = 0) const;
+    };
+
+    //==============================================================================
+    // writer side - there's only ever one writer per ring
+
+    // claims the first ring that no other instance is writing to
+    bool create ();
+    void close ();
+
+    // audio thread: publishes the messages of one block (sysex is left out)
+    void publish (const juce::MidiBuffer& buffer, double blockStartMs, double sampleRate) noexcept;
+
+    //==============================================================================
+    // reader side
+
+    bool openForReading (int ringNumber);
+
+    // copies up to maxEvents that haven't been read yet. Events the reader was too slow
+    // for (that were overwritten before they were read) are counted in getNumLost()
+    int read (Event* dest, int maxEvents) noexcept;
+    juce::uint64 getNumLost () const noexcept       { return numLost; }
+    bool hasWriter () const noexcept;
+
+    //==============================================================================
+    bool isOpen () const noexcept                   { return header != nullptr; }
+    int getRingNumber () const noexcept             { return ringNumber; }
+
+    static juce::File getRingFile (int ringNumber);
+
+private:
+    struct Header
+    {
+        juce::uint32 magic;
+        juce::uint32 version;
+        juce::uint32 capacity;
+        std::atomic<juce::uint32> writerActive;
+        std::atomic<juce::uint64> writeCount;   // number of events published so far
+    };
+
+    struct Slot
+    {
+        // 2n + 2 when the slot holds event n, odd while it's being written
+        std::atomic<juce::uint64> sequence;
+        double timeMs;
+        juce::uint8 numBytes;
+        juce::uint8 bytes[3];
+        juce::uint32 reserved;
+    };
+
+    static_assert (std::atomic<juce::uint64>::is_always_lock_free, "the ring needs lock-free 64 bit atomics");
+    static_assert ((capacity & (capacity - 1)) == 0, "the capacity must be a power of 2");
+
+    static constexpr juce::uint32 ringMagic = 0x76654d43;   // 'CMev'
+    static constexpr juce::uint32 ringVersion = 1;
+    static constexpr size_t fileSize = sizeof (Header) + sizeof (Slot) * capacity;
+
+    bool map (int number, juce::MemoryMappedFile::AccessMode mode);
+
+    std::unique_ptr<juce::InterProcessLock> writerLock;
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    Header* header = nullptr;
+    Slot* slots = nullptr;
+    int ringNumber = 0;
+
+    juce::uint64 writeCount = 0;    // writer only
+    juce::uint64 readCount = 0;     // reader only
+    juce::uint64 numLost = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (SharedEventRing)
+};
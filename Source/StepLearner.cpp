@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    StepLearner.cpp
+    Created: 18 Oct 2026 11:12:51pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "StepLearner.h"
+
+
+void StepLearner::setLearning (bool shouldLearn)
+{
+    // start from scratch each time (the audio thread does the clearing)
+    if (shouldLearn && ! learning) resetRequested = true;
+    learning = shouldLearn;
+}
+
+
+//==============================================================================
+
+
+void StepLearner::stepStarted (int step, juce::int64 cycle)
+{
+    if (resetRequested.exchange (false)) {
+        for (auto& s : visits) for (auto& c : s) c.store (0, std::memory_order_relaxed);
+        for (auto& s : hits) for (auto& c : s) c.store (0, std::memory_order_relaxed);
+    }
+
+    if (step < 0 || step >= numSteps) {
+        currentStep = -1;
+        return;
+    }
+
+    currentStep = step;
+    currentCycle = static_cast<int> ((cycle % numCycles + numCycles) % numCycles);
+    heardThisStep = false;
+
+    visits[(size_t) currentStep][(size_t) currentCycle].fetch_add (1, std::memory_order_relaxed);
+}
+
+
+void StepLearner::noteOn ()
+{
+    // a step only counts once, however many notes are played in it
+    if (currentStep < 0 || heardThisStep) return;
+
+    heardThisStep = true;
+    hits[(size_t) currentStep][(size_t) currentCycle].fetch_add (1, std::memory_order_relaxed);
+}
+
+
+//==============================================================================
+
+
+StepLearner::Suggestion StepLearner::getSuggestion (int step) const
+{
+    Suggestion suggestion;
+    if (step < 0 || step >= numSteps) return suggestion;
+
+    std::array<double, numCycles> stepVisits, stepHits;
+    double totalVisits = 0, totalHits = 0;
+
+    for (auto c=0; c<numCycles; c++) {
+        stepVisits[(size_t) c] = visits[(size_t) step][(size_t) c].load (std::memory_order_relaxed);
+        stepHits[(size_t) c] = hits[(size_t) step][(size_t) c].load (std::memory_order_relaxed);
+        totalVisits += stepVisits[(size_t) c];
+        totalHits += stepHits[(size_t) c];
+    }
+
+    // need to have heard the step a few times at least
+    if (totalVisits < 4) return suggestion;
+
+    suggestion.isValid = true;
+    suggestion.chance = static_cast<float> (totalHits / totalVisits);
+
+    // if (nearly) all the notes fell on the same one of every B cycles, it's an A:B condition.
+    // Try the shortest cycles first, and only once every one of them has come round twice.
+    if (totalHits >= 4) {
+        for (auto b : { 2, 4, 8, 16 }) {
+            if (totalVisits < 2 * b) break;
+
+            for (auto a=1; a<=b; a++) {
+                double conditionVisits = 0, conditionHits = 0;
+
+                for (auto c=a-1; c<numCycles; c+=b) {
+                    conditionVisits += stepVisits[(size_t) c];
+                    conditionHits += stepHits[(size_t) c];
+                }
+
+                if (conditionVisits > 0 && conditionHits >= 0.9 * totalHits) {
+                    suggestion.chance = static_cast<float> (juce::jmin (1.0, conditionHits / conditionVisits));
+                    suggestion.conditionA = a;
+                    suggestion.conditionB = b;
+                    return suggestion;
+                }
+            }
+        }
+    }
+
+    return suggestion;
+}
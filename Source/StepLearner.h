@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    StepLearner.h
+    Created: 18 Oct 2026 11:12:36pm
+    Author:  Boris Divjak
+
+    Learns how often each step is played from an incoming performance.
+    It counts how many times each step came round and how many of those
+    times a note was played in it (split by cycle, so it can also spot
+    steps that are only played every N cycles). Counting is a couple of
+    increments per step on the audio thread, and the results can be
+    read from any thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class StepLearner
+{
+public:
+    static constexpr int numSteps = 16;
+    static constexpr int numCycles = 16;    // cycles are counted modulo this (the longest condition)
+
+    // message thread
+    void setLearning (bool shouldLearn);
+    bool isLearning () const                { return learning; }
+
+    // audio thread - call when a step starts, and for every incoming note-on
+    void stepStarted (int step, juce::int64 cycle);
+    void noteOn ();
+
+    // any thread. What the chance and condition of a step seem to be,
+    // or isValid = false if the step hasn't been heard often enough
+    struct Suggestion
+    {
+        bool isValid = false;
+        float chance = 1.0f;
+        int conditionA = 1;
+        int conditionB = 1;
+    };
+
+    Suggestion getSuggestion (int step) const;
+
+private:
+    using Counters = std::array<std::array<std::atomic<juce::uint32>, numCycles>, numSteps>;
+
+    Counters visits {};
+    Counters hits {};
+
+    std::atomic<bool> learning { false };
+    std::atomic<bool> resetRequested { false };
+
+    // audio thread only
+    int currentStep = -1;
+    int currentCycle = 0;
+    bool heardThisStep = false;
+};
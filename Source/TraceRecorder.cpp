@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.cpp
+    Created: 19 Oct 2026 1:20:41pm
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "TraceRecorder.h"
+
+
+TraceRecorder& TraceRecorder::getInstance()
+{
+    static TraceRecorder instance;
+    return instance;
+}
+
+
+//==============================================================================
+
+
+void TraceRecorder::start ()
+{
+    stop();
+
+    // the buffers are only made the first time tracing is used, and then kept
+    if (threadBuffers == nullptr)
+        threadBuffers = std::make_unique<std::array<ThreadBuffer, maxThreads>>();
+
+    for (auto& buffer : *threadBuffers) {
+        buffer.numWritten = 0;
+        buffer.threadName[0] = 0;
+        buffer.isMessageThread = false;
+    }
+
+    numThreadBuffers = 0;
+    ++generation;
+    startTicks = juce::Time::getHighResolutionTicks();
+    recording = true;
+}
+
+
+void TraceRecorder::stop ()
+{
+    recording = false;
+
+    // a thread that got past the check in add() before this may still be writing
+    // (a thread that comes along after it sees recording is off)
+    while (activeWriters.load() > 0)
+        std::this_thread::yield();
+}
+
+
+//==============================================================================
+
+
+void TraceRecorder::add (const char* name, juce::int64 start, juce::int64 end) noexcept
+{
+    if (! isRecording()) return;
+
+    // counted before checking again, so stop() either waits for this or this sees it stopped
+    ++activeWriters;
+
+    if (recording.load()) {
+        if (auto* buffer = getThreadBuffer()) {
+            auto index = buffer->numWritten.load (std::memory_order_relaxed);
+            buffer->events[(size_t) (index & (eventsPerThread - 1))] = { name, start, end };
+            buffer->numWritten.store (index + 1, std::memory_order_release);
+        }
+    }
+
+    --activeWriters;
+}
+
+
+TraceRecorder::ThreadBuffer* TraceRecorder::getThreadBuffer () noexcept
+{
+    // each thread picks a buffer the first time it records something (after each start())
+    thread_local int threadGeneration = -1;
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+
+    auto currentGeneration = generation.load (std::memory_order_acquire);
+
+    if (threadGeneration != currentGeneration) {
+        threadGeneration = currentGeneration;
+        threadBuffer = nullptr;
+
+        auto index = numThreadBuffers.fetch_add (1);
+
+        // too many threads - the rest aren't recorded
+        if (index < maxThreads) {
+            threadBuffer = &(*threadBuffers)[(size_t) index];
+            threadBuffer->isMessageThread = juce::MessageManager::existsAndIsCurrentThread();
+
+            if (auto* thread = juce::Thread::getCurrentThread())
+                thread->getThreadName().copyToUTF8 (threadBuffer->threadName.data(), threadBuffer->threadName.size());
+        }
+    }
+
+    return threadBuffer;
+}
+
+
+//==============================================================================
+
+
+bool TraceRecorder::writeTo (const juce::File& file)
+{
+    stop();
+
+    if (threadBuffers == nullptr) return false;
+
+    juce::FileOutputStream stream (file);
+    if (! stream.openedOk()) return false;
+
+    stream.setPosition (0);
+    stream.truncate();
+
+    // times in the file are microseconds since start()
+    auto ticksPerMicrosecond = static_cast<double> (juce::Time::getHighResolutionTicksPerSecond()) / 1.0e6;
+    auto toMicroseconds = [&] (juce::int64 ticks) { return static_cast<double> (ticks - startTicks) / ticksPerMicrosecond; };
+
+    stream << "{\"traceEvents\":[\n";
+    auto first = true;
+
+    auto numThreads = juce::jmin (numThreadBuffers.load(), maxThreads);
+
+    for (auto t = 0; t < numThreads; ++t)
+    {
+        auto& buffer = (*threadBuffers)[(size_t) t];
+
+        // name the thread, so the timeline shows which one it is
+        auto name = buffer.isMessageThread ? juce::String ("Message thread")
+                  : buffer.threadName[0] != 0 ? juce::String::fromUTF8 (buffer.threadName.data())
+                  : "Host thread " + juce::String (t + 1);
+
+        stream << (first ? "" : ",\n")
+               << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << (t + 1)
+               << ",\"args\":{\"name\":" << juce::JSON::toString (name) << "}}";
+        first = false;
+
+        // only the most recent events are still there
+        auto numWritten = buffer.numWritten.load (std::memory_order_acquire);
+        auto from = numWritten > (juce::uint64) eventsPerThread ? numWritten - (juce::uint64) eventsPerThread : 0;
+
+        for (auto i = from; i < numWritten; ++i)
+        {
+            auto& event = buffer.events[(size_t) (i & (eventsPerThread - 1))];
+
+            stream << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (t + 1)
+                   << ",\"ts\":" << juce::String (toMicroseconds (event.startTicks), 3)
+                   << ",\"dur\":" << juce::String (toMicroseconds (event.endTicks) - toMicroseconds (event.startTicks), 3) << "}";
+        }
+    }
+
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    stream.flush();
+
+    return stream.getStatus().wasOk();
+}
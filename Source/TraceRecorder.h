@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.h
+    Created: 19 Oct 2026 1:20:18pm
+    Author:  Boris Divjak
+
+    Records how long things take on each thread (processing a block,
+    sending MIDI, painting, saving state...) and writes it out as a
+    Chrome trace file, which can be opened in chrome://tracing or
+    ui.perfetto.dev to see a timeline of where the time goes.
+
+    Put a Scope at the start of anything worth timing. While tracing is
+    off, a scope only checks a flag. While it's on, each thread writes to
+    a buffer of its own (no locks, no allocation), and only the most
+    recent events are kept. The message thread only touches the buffers
+    once recording is off and every thread has finished what it was
+    writing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class TraceRecorder
+{
+public:
+    // one recorder for all instances in the process
+    static TraceRecorder& getInstance();
+
+    // message thread. Starting again throws away what was recorded before.
+    // stop() returns once no thread is writing any more.
+    void start ();
+    void stop ();
+    bool isRecording () const noexcept      { return recording.load (std::memory_order_relaxed); }
+
+    // message thread: stops recording and writes everything to a Chrome trace (JSON) file
+    bool writeTo (const juce::File& file);
+
+    //==============================================================================
+    // times whatever happens between its construction and destruction.
+    // The name has to be a string literal (or live for as long).
+    class Scope
+    {
+    public:
+        explicit Scope (const char* name) noexcept
+            : eventName (name), startTicks (getInstance().isRecording() ? juce::Time::getHighResolutionTicks() : 0) {}
+
+        ~Scope()
+        {
+            if (startTicks != 0)
+                getInstance().add (eventName, startTicks, juce::Time::getHighResolutionTicks());
+        }
+
+    private:
+        const char* eventName;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (Scope)
+    };
+
+private:
+    TraceRecorder() = default;
+
+    static constexpr int maxThreads = 32;
+    static constexpr int eventsPerThread = 16384;   // must be a power of 2
+
+    struct Event
+    {
+        const char* name;
+        juce::int64 startTicks;
+        juce::int64 endTicks;
+    };
+
+    struct ThreadBuffer
+    {
+        std::array<Event, eventsPerThread> events;
+        std::atomic<juce::uint64> numWritten { 0 };
+        std::array<char, 64> threadName {};     // UTF-8 (filled in by the thread itself, so no allocating)
+        bool isMessageThread = false;
+    };
+
+    void add (const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+    ThreadBuffer* getThreadBuffer () noexcept;
+
+    std::atomic<bool> recording { false };
+    std::atomic<int> activeWriters { 0 };       // threads inside add() right now
+    std::atomic<int> generation { 0 };          // goes up with every start(), so threads pick a new buffer
+    std::atomic<int> numThreadBuffers { 0 };
+    std::unique_ptr<std::array<ThreadBuffer, maxThreads>> threadBuffers;
+    juce::int64 startTicks = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (TraceRecorder)
+};
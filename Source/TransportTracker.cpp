@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    TransportTracker.cpp
+    Created: 18 Oct 2026 11:40:32am
+    Author:  Boris Divjak
+
+  ==============================================================================
+*/
+
+#include "TransportTracker.h"
+
+
+void TransportTracker::prepare (double newSampleRate)
+{
+    if (newSampleRate > 0) sampleRate = newSampleRate;
+    reset();
+}
+
+
+void TransportTracker::reset ()
+{
+    playing = false;
+    hasPrevious = false;
+    ppq = 0.0;
+    expectedPpq = 0.0;
+    loopOffset = 0.0;
+}
+
+
+//==============================================================================
+
+
+TransportTracker::Change TransportTracker::update (const juce::AudioPlayHead::PositionInfo& position, int numSamples)
+{
+    auto nowPlaying = position.getIsPlaying();
+    auto newPpq = position.getPpqPosition().orFallback (ppq);
+    auto bpm = position.getBpm().orFallback (120.0);
+    auto change = Change::none;
+
+    if (nowPlaying && ! playing) {
+        change = Change::started;
+        loopOffset = 0.0;
+    }
+    else if (! nowPlaying && playing) {
+        change = Change::stopped;
+    }
+    else if (nowPlaying && hasPrevious && std::abs (newPpq - expectedPpq) > jumpTolerance) {
+        auto loop = position.getLoopPoints();
+
+        // moving backwards while looping means we've wrapped around - keep counting
+        // from the end of the loop, so the cycle counter doesn't start over
+        if (position.getIsLooping() && loop.hasValue() && newPpq < expectedPpq
+            && loop->ppqEnd > loop->ppqStart) {
+            loopOffset += loop->ppqEnd - loop->ppqStart;
+            change = Change::looped;
+        }
+        else {
+            loopOffset = 0.0;
+            change = Change::jumped;
+        }
+    }
+
+    playing = nowPlaying;
+    hasPrevious = true;
+    ppq = newPpq;
+    expectedPpq = newPpq + numSamples / sampleRate * bpm / 60.0;
+
+    return change;
+}
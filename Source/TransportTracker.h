@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    TransportTracker.h
+    Created: 18 Oct 2026 11:40:17am
+    Author:  Boris Divjak
+
+    Follows the host transport from block to block and works out when it
+    has started, stopped, jumped to a new position or wrapped around a loop,
+    so the sequencer can resync straight away instead of a block later.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+
+
+class TransportTracker
+{
+public:
+    enum class Change { none, started, stopped, jumped, looped };
+
+    void prepare (double sampleRate);
+    void reset ();
+
+    // call once per block, returns what happened since the previous block
+    Change update (const juce::AudioPlayHead::PositionInfo& position, int numSamples);
+
+    bool isPlaying () const         { return playing; }
+
+    // host position plus the length of every loop wrap since the transport
+    // started, so steps and cycles keep counting up while the host loops
+    double getContinuousPpq () const    { return ppq + loopOffset; }
+
+private:
+    // anything further than this from where we expected to be is a jump (in quarter notes)
+    static constexpr double jumpTolerance = 1.0 / 64.0;
+
+    double sampleRate = 44100.0;
+    bool playing = false;
+    bool hasPrevious = false;
+    double ppq = 0.0;
+    double expectedPpq = 0.0;
+    double loopOffset = 0.0;
+};
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+    Created: 18 Oct 2026 8:41:12pm
+    Author:  Boris Divjak
+
+    Hands complete copies of some data from one thread to another without
+    locks. The writer fills in the back buffer and publishes it, the reader
+    picks up the most recently published one whenever it's ready. Neither
+    side ever waits for the other, and the reader never sees a half
+    written value. Works for one writer thread and one reader thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+//==============================================================================
+
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    //==============================================================================
+    // writer side: fill in the whole of this, then publish it
+    T& getWriteBuffer () noexcept       { return buffers[(std::size_t) back]; }
+
+    void publish () noexcept
+    {
+        back = middle.exchange (back | newDataFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    //==============================================================================
+    // reader side: returns true if there's something new to read
+    bool update () noexcept
+    {
+        if ((middle.load (std::memory_order_relaxed) & newDataFlag) == 0)
+            return false;
+
+        front = middle.exchange (front, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T& read () const noexcept     { return buffers[(std::size_t) front]; }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+
+    std::array<T, 3> buffers {};
+    int front = 0;
+    std::atomic<int> middle { 1 };
+    int back = 2;
+};
@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 18 Oct 2026 10:41:27pm
+    Author:  Boris Divjak
+
+    ChanceBatch - renders lots of variations of Chance Machine patterns to
+    MIDI files, using all the cores it can get. Each pattern is played
+    once per seed, and every variation is written to its own file.
+
+    Pattern files are the plugin's own state, saved as XML (see PatternFile.h).
+
+    Usage:
+        ChanceBatch [--seeds=1-100] [--bars=4] [--bpm=120] [--note=36]
+                    [--threads=0] [--out=folder] pattern.xml [pattern2.xml ...]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PatternFile.h"
+
+namespace
+{
+    using Engine = PatternFile::Engine;
+
+    constexpr int ticksPerQuarterNote = 960;
+
+
+    //==============================================================================
+    struct Settings
+    {
+        juce::int64 firstSeed = 1;
+        juce::int64 lastSeed = 16;
+        int bars = 4;
+        double bpm = 120.0;
+        int note = 36;
+        int velocity = 100;
+        int numThreads = 0;     // 0 = one per core
+        double quarterNotesPerBar = 4.0;
+        juce::File outputFolder = juce::File::getCurrentWorkingDirectory();
+    };
+
+
+    //==============================================================================
+    // plays one pattern with one seed, the same way the plugin would
+    juce::MidiFile render (const Engine::Pattern& pattern, juce::int64 seed, const Settings& settings)
+    {
+        Engine engine (static_cast<std::uint64_t> (seed));
+
+        juce::MidiMessageSequence track;
+        track.addEvent (juce::MidiMessage::tempoMetaEvent (juce::roundToInt (60000000.0 / settings.bpm)), 0);
+        track.addEvent (juce::MidiMessage::timeSignatureMetaEvent (juce::roundToInt (settings.quarterNotesPerBar), 4), 0);
+
+        // use ticks as 'samples', so step positions come out in ticks
+        SequencerTimeline timeline;
+        timeline.ppqPerSample = 1.0 / ticksPerQuarterNote;
+        timeline.numSamples = ticksPerQuarterNote;
+
+        auto spq = pattern.stepsPerQuarterNote;
+        auto length = settings.bars * settings.quarterNotesPerBar;
+        std::array<SequencerEvent, 64> events;
+
+        for (auto ppq = 0.0; ppq < length; ppq += 1.0) {
+            timeline.ppqStart = ppq;
+            auto numEvents = engine.process (pattern, timeline, events.data(), static_cast<int> (events.size()));
+
+            for (auto i = 0; i < numEvents; ++i) {
+                auto& event = events[(size_t) i];
+                if (! event.fired) continue;
+
+                auto ratchets = juce::jmax (1, static_cast<int> (pattern.steps[0][(size_t) event.step].ratchets));
+                auto start = event.ppq + pattern.getTimingOffset (event.lane, event.step) / spq;
+
+                for (auto r = 0; r < ratchets; ++r) {
+                    auto on = juce::jmax (0.0, start + r / (spq * ratchets)) * ticksPerQuarterNote;
+                    auto off = on + 0.5 / (spq * ratchets) * ticksPerQuarterNote;
+
+                    track.addEvent (juce::MidiMessage::noteOn (1, settings.note, static_cast<juce::uint8> (settings.velocity)), on);
+                    track.addEvent (juce::MidiMessage::noteOff (1, settings.note), off);
+                }
+            }
+        }
+
+        track.updateMatchedPairs();
+
+        juce::MidiFile midiFile;
+        midiFile.setTicksPerQuarterNote (ticksPerQuarterNote);
+        midiFile.addTrack (track);
+        return midiFile;
+    }
+
+
+    //==============================================================================
+    class RenderJob  : public juce::ThreadPoolJob
+    {
+    public:
+        RenderJob (const PatternFile& p, juce::int64 s, const Settings& settings_, std::atomic<int>& failures_)
+            : juce::ThreadPoolJob ("render"), patternFile (p), seed (s), settings (settings_), failures (failures_) {}
+
+        JobStatus runJob() override
+        {
+            auto midiFile = render (patternFile.pattern, seed, settings);
+            auto name = patternFile.file.getFileNameWithoutExtension() + "_seed" + juce::String (seed) + ".mid";
+            auto outputFile = settings.outputFolder.getChildFile (name);
+
+            juce::FileOutputStream stream (outputFile);
+
+            if (! stream.openedOk() || ! stream.setPosition (0) || ! stream.truncate().wasOk()
+                || ! midiFile.writeTo (stream)) {
+                ++failures;
+            }
+
+            return jobHasFinished;
+        }
+
+    private:
+        const PatternFile& patternFile;
+        juce::int64 seed;
+        const Settings& settings;
+        std::atomic<int>& failures;
+    };
+
+
+    //==============================================================================
+    int printUsage()
+    {
+        std::cout << "Usage: ChanceBatch [--seeds=1-100] [--bars=4] [--bpm=120] [--note=36]" << std::endl
+                  << "                   [--threads=0] [--out=folder] pattern.xml [pattern2.xml ...]" << std::endl;
+        return 1;
+    }
+}
+
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    Settings settings;
+    juce::Array<juce::File> files;
+
+    for (auto i = 1; i < argc; ++i) {
+        juce::String arg (argv[i]);
+
+        if (arg.startsWith ("--")) {
+            auto name = arg.upToFirstOccurrenceOf ("=", false, false);
+            auto value = arg.fromFirstOccurrenceOf ("=", false, false);
+
+            if (name == "--seeds") {
+                settings.firstSeed = value.upToFirstOccurrenceOf ("-", false, false).getLargeIntValue();
+                settings.lastSeed = value.contains ("-") ? value.fromFirstOccurrenceOf ("-", false, false).getLargeIntValue()
+                                                         : settings.firstSeed;
+            }
+            else if (name == "--bars")      settings.bars = juce::jmax (1, value.getIntValue());
+            else if (name == "--bpm")       settings.bpm = juce::jlimit (20.0, 300.0, value.getDoubleValue());
+            else if (name == "--note")      settings.note = juce::jlimit (0, 127, value.getIntValue());
+            else if (name == "--threads")   settings.numThreads = juce::jmax (0, value.getIntValue());
+            else if (name == "--out")       settings.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile (value);
+            else                            return printUsage();
+        }
+        else {
+            files.add (juce::File::getCurrentWorkingDirectory().getChildFile (arg));
+        }
+    }
+
+    if (files.isEmpty() || settings.lastSeed < settings.firstSeed)
+        return printUsage();
+
+    // load all the patterns first, so the render threads only have to read them
+    std::vector<PatternFile> patterns (static_cast<size_t> (files.size()));
+
+    for (auto i = 0; i < files.size(); ++i) {
+        juce::String error;
+        if (! patterns[(size_t) i].load (files[i], settings.quarterNotesPerBar, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    if (! settings.outputFolder.createDirectory()) {
+        std::cerr << "can't create " << settings.outputFolder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // every variation is a separate job - they don't share anything apart from the
+    // (read only) patterns, so they spread out over all the threads
+    auto numThreads = settings.numThreads > 0 ? settings.numThreads : juce::SystemStats::getNumCpus();
+    auto numRenders = static_cast<int> ((settings.lastSeed - settings.firstSeed + 1) * (juce::int64) patterns.size());
+    std::atomic<int> failures { 0 };
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    {
+        juce::ThreadPool pool (numThreads);
+
+        for (auto& pattern : patterns)
+            for (auto seed = settings.firstSeed; seed <= settings.lastSeed; ++seed)
+                pool.addJob (new RenderJob (pattern, seed, settings, failures), true);
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep (5);
+    }
+    auto seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    std::cout << "Rendered " << numRenders - failures.load() << " of " << numRenders << " variations on "
+              << numThreads << " threads in " << juce::String (seconds, 2) << " s ("
+              << juce::String (numRenders / juce::jmax (seconds, 0.001), 1) << " renders / s)" << std::endl;
+
+    return failures > 0 ? 1 : 0;
+}
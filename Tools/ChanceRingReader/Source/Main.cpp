@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 19 Oct 2026 11:48:02am
+    Author:  Boris Divjak
+
+    ChanceRingReader - follows the shared memory ring of a Chance Machine
+    instance (switch on 'Share' in the plugin), and either logs the events
+    or plays them on a MIDI output, each at the time it was meant for.
+
+    Every few seconds it prints how far ahead of time the events arrived
+    (the plugin publishes each block as it's processed, so this should be
+    positive) and how close to their time they were sent out.
+
+    Usage:
+        ChanceRingReader --list
+        ChanceRingReader [--ring=1] [--midi=name] [--log] [--seconds=0]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/SharedEventRing.h"
+
+namespace
+{
+    struct Settings
+    {
+        int ring = 0;               // 0 = the first one with a writer
+        juce::String midiOutput;    // part of the device name
+        bool log = false;
+        double seconds = 0;         // 0 = until stopped
+    };
+
+
+    //==============================================================================
+    // keeps a running mean and range of some timings
+    struct TimingStats
+    {
+        void add (double ms)
+        {
+            total += ms;
+            lowest = count == 0 ? ms : juce::jmin (lowest, ms);
+            highest = count == 0 ? ms : juce::jmax (highest, ms);
+            ++count;
+        }
+
+        juce::String toString() const
+        {
+            if (count == 0) return "-";
+            return juce::String (total / count, 2) + " ms (" + juce::String (lowest, 2) + " .. " + juce::String (highest, 2) + ")";
+        }
+
+        juce::int64 count = 0;
+        double total = 0, lowest = 0, highest = 0;
+    };
+
+
+    //==============================================================================
+    int listRings()
+    {
+        for (auto number = 1; number <= SharedEventRing::maxRings; ++number) {
+            SharedEventRing ring;
+
+            if (ring.openForReading (number))
+                std::cout << "ring " << number << (ring.hasWriter() ? "" : " (no writer)") << std::endl;
+        }
+
+        return 0;
+    }
+
+
+    int printUsage()
+    {
+        std::cout << "Usage: ChanceRingReader --list" << std::endl
+                  << "       ChanceRingReader [--ring=1] [--midi=name] [--log] [--seconds=0]" << std::endl;
+        return 1;
+    }
+}
+
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    Settings settings;
+
+    for (auto i = 1; i < argc; ++i) {
+        juce::String arg (argv[i]);
+        auto name = arg.upToFirstOccurrenceOf ("=", false, false);
+        auto value = arg.fromFirstOccurrenceOf ("=", false, false);
+
+        if (name == "--list")           return listRings();
+        else if (name == "--ring")      settings.ring = value.getIntValue();
+        else if (name == "--midi")      settings.midiOutput = value;
+        else if (name == "--log")       settings.log = true;
+        else if (name == "--seconds")   settings.seconds = juce::jmax (0.0, value.getDoubleValue());
+        else                            return printUsage();
+    }
+
+    // find the ring
+    SharedEventRing ring;
+
+    for (auto number = 1; number <= SharedEventRing::maxRings && ! ring.isOpen(); ++number) {
+        if (settings.ring != 0 && number != settings.ring) continue;
+        if (ring.openForReading (number) && settings.ring == 0 && ! ring.hasWriter()) ring.close();
+    }
+
+    if (! ring.isOpen()) {
+        std::cerr << "can't find a Chance Machine ring - switch on 'Share' in the plugin" << std::endl;
+        return 1;
+    }
+
+    // and the MIDI output, if there is one
+    std::unique_ptr<juce::MidiOutput> output;
+
+    if (settings.midiOutput.isNotEmpty()) {
+        for (auto& device : juce::MidiOutput::getAvailableDevices())
+            if (device.name.containsIgnoreCase (settings.midiOutput)) {
+                output = juce::MidiOutput::openDevice (device.identifier);
+                break;
+            }
+
+        if (output == nullptr) {
+            std::cerr << "can't open a MIDI output called " << settings.midiOutput << std::endl;
+            return 1;
+        }
+    }
+
+    if (output == nullptr && ! settings.log)
+        settings.log = true;
+
+    std::cout << "Reading ring " << ring.getRingNumber()
+              << (output != nullptr ? " to " + output->getName() : juce::String()) << std::endl;
+
+    // events wait here until they're due
+    std::vector<SharedEventRing::Event> waiting;
+    std::array<SharedEventRing::Event, 256> incoming;
+
+    TimingStats ahead, sendError;
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    auto nextReport = startTime + 5000.0;
+    juce::int64 numEvents = 0;
+
+    for (;;)
+    {
+        auto now = juce::Time::getMillisecondCounterHiRes();
+
+        if (settings.seconds > 0 && now - startTime > settings.seconds * 1000.0)
+            break;
+
+        for (auto n = ring.read (incoming.data(), (int) incoming.size()); n > 0; n = ring.read (incoming.data(), (int) incoming.size())) {
+            for (auto i = 0; i < n; ++i) {
+                ahead.add (incoming[(size_t) i].timeMs - now);
+                waiting.push_back (incoming[(size_t) i]);
+            }
+        }
+
+        // send (or log) whatever is due, in time order
+        std::stable_sort (waiting.begin(), waiting.end(), [] (const auto& a, const auto& b) { return a.timeMs < b.timeMs; });
+
+        auto due = waiting.begin();
+        for (; due != waiting.end() && due->timeMs <= now; ++due) {
+            auto message = due->getMessage();
+
+            if (output != nullptr)
+                output->sendMessageNow (message);
+
+            sendError.add (juce::Time::getMillisecondCounterHiRes() - due->timeMs);
+            ++numEvents;
+
+            if (settings.log)
+                std::cout << juce::String (due->timeMs - startTime, 1) << " ms  " << message.getDescription() << std::endl;
+        }
+        waiting.erase (waiting.begin(), due);
+
+        if (now >= nextReport) {
+            std::cout << numEvents << " events, " << (juce::int64) ring.getNumLost() << " lost"
+                      << " | arrived ahead: " << ahead.toString()
+                      << " | sent late by: " << sendError.toString() << std::endl;
+
+            ahead = {};
+            sendError = {};
+            nextReport = now + 5000.0;
+        }
+
+        // poll again in a moment
+        juce::Thread::sleep (1);
+    }
+
+    std::cout << numEvents << " events, " << (juce::int64) ring.getNumLost() << " lost" << std::endl;
+    return 0;
+}
@@ -0,0 +1,580 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 19 Oct 2026 6:31:17pm
+    Author:  Boris Divjak
+
+    ChanceServer - plays lots of Chance Machine patterns at once, with no
+    DAW (e.g. on a small Linux box). Each pattern gets an engine of its
+    own, and they all follow one transport: the built-in one at a fixed
+    tempo, or MIDI clock coming in on a MIDI input. Each engine plays a
+    note on the MIDI output, channel and note given before its pattern.
+
+    The engines are run every couple of milliseconds, a little ahead of
+    time (and half of the longest step further ahead still, so steps that
+    are played early can be), and their notes are handed to each output's
+    background thread to be sent when they're due. Every so often it prints how much CPU
+    time each engine took.
+
+    With --stress it runs more and more engines flat out instead (with no
+    MIDI), to show how many of them fit in one core.
+
+    Usage:
+        ChanceServer --list
+        ChanceServer [--bpm=120] [--clock=input] [--period=2] [--latency=10]
+                     [--seconds=0] [--report=10] [--seed=0]
+                     --midi=output [--channel=1] [--note=36] [--velocity=100] pattern.xml ...
+        ChanceServer --stress=256 [--bpm=120] [--period=2] pattern.xml ...
+
+    --midi, --channel, --note and --velocity apply to the patterns after them.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <csignal>
+#include "../../../Source/PatternFile.h"
+#include "../../../Source/InternalTransport.h"
+#include "../../../Source/MIDIClockFollower.h"
+
+namespace
+{
+    using Engine = PatternFile::Engine;
+
+    // the engines and transports count time in samples, at this rate
+    constexpr double sampleRate = 48000.0;
+
+    std::atomic<bool> stopRequested { false };
+
+    void handleSignal (int)
+    {
+        stopRequested = true;
+    }
+
+
+    //==============================================================================
+    struct Settings
+    {
+        double bpm = 120.0;
+        double quarterNotesPerBar = 4.0;
+        juce::String clockInput;    // part of the device name - follows its clock instead of the built-in transport
+        double periodMs = 2.0;      // how often the engines are run
+        double latencyMs = 10.0;    // how far ahead of time
+        double seconds = 0;         // 0 = until stopped
+        double reportSeconds = 10.0;
+        juce::int64 seed = 0;       // 0 = a different one every time
+        int stress = 0;             // the most engines to try in the stress test (0 = no test)
+    };
+
+
+    // where a pattern is played
+    struct Voice
+    {
+        juce::String midiOutput;    // part of the device name
+        int channel = 1;
+        int note = 36;
+        int velocity = 100;
+    };
+
+
+    struct Output
+    {
+        juce::String name;
+        std::unique_ptr<juce::MidiOutput> device;
+        juce::MidiBuffer buffer;    // the notes for the current block
+    };
+
+
+    // one pattern, playing on one output
+    struct Player
+    {
+        Player (const PatternFile& p, const Voice& v, juce::int64 seed)
+            : patternFile (p), voice (v), engine (static_cast<std::uint64_t> (seed)) {}
+
+        PatternFile patternFile;
+        Voice voice;
+        Engine engine;
+        Output* output = nullptr;
+
+        // CPU time spent in this engine since the last report
+        juce::int64 busyTicks = 0;
+        juce::int64 worstTicks = 0;
+        juce::int64 numBlocks = 0;
+        juce::int64 numNotes = 0;
+    };
+
+
+    //==============================================================================
+    // Steps can be played up to half a step early, so the engines run ahead of the
+    // block they fill in by half of the longest step of all the patterns (in quarter
+    // notes), and each note is put back where it belongs - like the plugin does.
+    double getLeadPpq (const std::vector<Player>& players)
+    {
+        auto longest = 0.0;
+
+        for (auto& player : players)
+            if (player.patternFile.pattern.stepsPerQuarterNote > 0)
+                longest = juce::jmax (longest, 1.0 / player.patternFile.pattern.stepsPerQuarterNote);
+
+        return 0.5 * longest;
+    }
+
+
+    // runs one engine over the span, and adds the notes it plays to the buffer, delayed by
+    // delaySamples (the span is that far ahead of the start of the buffer)
+    void playSpan (Player& player, const SequencerTimeline& span, double delaySamples, juce::MidiBuffer& buffer)
+    {
+        const auto& pattern = player.patternFile.pattern;
+        std::array<SequencerEvent, 64> events;
+        auto numEvents = player.engine.process (pattern, span, events.data(), static_cast<int> (events.size()));
+
+        for (auto i = 0; i < numEvents; ++i) {
+            auto& event = events[(size_t) i];
+            if (! event.fired || span.ppqPerSample <= 0) continue;
+
+            // played like ChanceBatch does: moved by the step's timing (and swing), with the
+            // ratchets spread across the step, and each note held for half of its share
+            auto samplesPerStep = 1.0 / (pattern.stepsPerQuarterNote * span.ppqPerSample);
+            auto ratchets = juce::jmax (1, static_cast<int> (pattern.steps[(size_t) event.lane][(size_t) event.step].ratchets));
+            auto start = event.samplePosition + delaySamples + pattern.getTimingOffset (event.lane, event.step) * samplesPerStep;
+
+            for (auto r = 0; r < ratchets; ++r) {
+                // only steps caught up with after a restart can be due before the buffer starts
+                auto on = juce::jmax (0.0, start + r * samplesPerStep / ratchets);
+                auto off = on + 0.5 * samplesPerStep / ratchets;
+
+                // notes can be after the end of the block - they're sent when they're due all the same
+                buffer.addEvent (juce::MidiMessage::noteOn (player.voice.channel, player.voice.note,
+                                                            static_cast<juce::uint8> (player.voice.velocity)), juce::roundToInt (on));
+                buffer.addEvent (juce::MidiMessage::noteOff (player.voice.channel, player.voice.note), juce::roundToInt (off));
+                ++player.numNotes;
+            }
+        }
+    }
+
+
+    // runs one engine for one block (leadPpq ahead of it), and adds the notes it plays to the buffer
+    void playBlock (Player& player, const SequencerTimeline& timeline, double leadPpq, bool restarted, juce::MidiBuffer& buffer)
+    {
+        auto startTicks = juce::Time::getHighResolutionTicks();
+        auto leadSamples = timeline.ppqPerSample > 0 ? leadPpq / timeline.ppqPerSample : 0.0;
+
+        // after a (re)start nothing has been worked out ahead yet, so the steps
+        // up to the lead are played straight away
+        if (restarted && leadSamples > 0) {
+            auto catchUp = timeline;
+            catchUp.numSamples = static_cast<int> (std::ceil (leadSamples));
+            playSpan (player, catchUp, 0.0, buffer);
+        }
+
+        auto ahead = timeline;
+        ahead.ppqStart += leadPpq;
+        playSpan (player, ahead, leadSamples, buffer);
+
+        auto ticks = juce::Time::getHighResolutionTicks() - startTicks;
+        player.busyTicks += ticks;
+        player.worstTicks = juce::jmax (player.worstTicks, ticks);
+        ++player.numBlocks;
+    }
+
+
+    //==============================================================================
+    // collects incoming MIDI (on the device's own thread) until the next block picks it up
+    class ClockInput  : public juce::MidiInputCallback
+    {
+    public:
+        ~ClockInput() override
+        {
+            if (device != nullptr) device->stop();
+        }
+
+        bool open (const juce::String& name)
+        {
+            for (auto& info : juce::MidiInput::getAvailableDevices()) {
+                if (info.name.containsIgnoreCase (name)) {
+                    device = juce::MidiInput::openDevice (info.identifier, this);
+                    break;
+                }
+            }
+
+            if (device == nullptr) return false;
+
+            device->start();
+            return true;
+        }
+
+        juce::String getName () const       { return device != nullptr ? device->getName() : juce::String(); }
+
+        // moves everything that came in since the last call into the buffer, at the sample
+        // position it arrived at (counting from startMs, on the millisecond counter)
+        void read (juce::MidiBuffer& buffer, double startMs, int numSamples)
+        {
+            const juce::ScopedLock sl (lock);
+
+            for (auto& message : pending) {
+                auto position = juce::roundToInt ((message.getTimeStamp() * 1000.0 - startMs) * sampleRate / 1000.0);
+                buffer.addEvent (message, juce::jlimit (0, numSamples - 1, position));
+            }
+
+            pending.clearQuick();
+        }
+
+    private:
+        void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message) override
+        {
+            // only clock and transport messages matter here
+            if (message.getRawDataSize() > 3) return;
+
+            const juce::ScopedLock sl (lock);
+            pending.add (message);
+        }
+
+        juce::CriticalSection lock;
+        juce::Array<juce::MidiMessage> pending;
+        std::unique_ptr<juce::MidiInput> device;
+    };
+
+
+    //==============================================================================
+    void printReport (std::vector<Player>& players, double elapsedMs)
+    {
+        auto ticksPerMs = static_cast<double> (juce::Time::getHighResolutionTicksPerSecond()) / 1000.0;
+        juce::int64 totalTicks = 0;
+
+        for (auto& player : players) {
+            auto busyMs = static_cast<double> (player.busyTicks) / ticksPerMs;
+
+            std::cout << "  " << player.patternFile.file.getFileName().paddedRight (' ', 24)
+                      << juce::String (player.numNotes).paddedLeft (' ', 6) << " notes  "
+                      << juce::String (busyMs * 1000.0 / (double) juce::jmax ((juce::int64) 1, player.numBlocks), 2) << " us / block (worst "
+                      << juce::String (static_cast<double> (player.worstTicks) / ticksPerMs * 1000.0, 1) << " us)  "
+                      << juce::String (100.0 * busyMs / elapsedMs, 3) << " % of a core" << std::endl;
+
+            totalTicks += player.busyTicks;
+            player.busyTicks = player.worstTicks = player.numBlocks = player.numNotes = 0;
+        }
+
+        std::cout << players.size() << " engines: "
+                  << juce::String (100.0 * static_cast<double> (totalTicks) / ticksPerMs / elapsedMs, 2) << " % of a core" << std::endl;
+    }
+
+
+    // stops everything that's waiting to be sent, and any notes that are still playing
+    void stopAllNotes (std::vector<Player>& players, juce::OwnedArray<Output>& outputs)
+    {
+        for (auto* output : outputs)
+            output->device->clearAllPendingMessages();
+
+        for (auto& player : players)
+            player.output->device->sendMessageNow (juce::MidiMessage::noteOff (player.voice.channel, player.voice.note));
+    }
+
+
+    //==============================================================================
+    int runServer (std::vector<Player>& players, juce::OwnedArray<Output>& outputs, const Settings& settings)
+    {
+        auto blockSamples = juce::jmax (16, juce::roundToInt (settings.periodMs * sampleRate / 1000.0));
+        auto blockMs = blockSamples * 1000.0 / sampleRate;
+        auto followClock = settings.clockInput.isNotEmpty();
+        auto leadPpq = getLeadPpq (players);
+
+        InternalTransport internalTransport;
+        MIDIClockFollower midiClock;
+        internalTransport.prepare (sampleRate);
+        midiClock.prepare (sampleRate);
+
+        ClockInput clockInput;
+
+        if (followClock && ! clockInput.open (settings.clockInput)) {
+            std::cerr << "can't open a MIDI input called " << settings.clockInput << std::endl;
+            return 1;
+        }
+
+        for (auto* output : outputs)
+            output->device->startBackgroundThread();
+
+        std::cout << "Playing " << players.size() << " patterns, " << juce::String (blockMs, 2) << " ms blocks, "
+                  << (followClock ? "following the clock from " + clockInput.getName() : juce::String (settings.bpm, 1) + " BPM")
+                  << std::endl;
+
+        juce::MidiBuffer clockMessages;
+        clockMessages.ensureSize (1024);
+
+        auto startTime = juce::Time::getMillisecondCounterHiRes();
+        auto reportStart = startTime;
+
+        for (juce::int64 block = 0; ! stopRequested; ++block)
+        {
+            // each block is worked out latencyMs before it's played
+            auto blockTimeMs = startTime + settings.latencyMs + static_cast<double> (block) * blockMs;
+            auto wakeTime = blockTimeMs - settings.latencyMs;
+
+            for (auto now = juce::Time::getMillisecondCounterHiRes(); now < wakeTime; now = juce::Time::getMillisecondCounterHiRes()) {
+                if (wakeTime - now > 1.5)   juce::Thread::sleep (static_cast<int> (wakeTime - now - 1.0));
+                else                        juce::Thread::yield();
+            }
+
+            if (settings.seconds > 0 && wakeTime - startTime >= settings.seconds * 1000.0)
+                break;
+
+            SequencerTimeline timeline;
+            timeline.numSamples = blockSamples;
+            auto change = TransportTracker::Change::none;
+
+            if (followClock) {
+                // the clock that came in during the last block says where we are now...
+                clockMessages.clear();
+                clockInput.read (clockMessages, wakeTime - blockMs, blockSamples);
+                change = midiClock.update (clockMessages, blockSamples);
+
+                // ...and this block is played a block and latencyMs after that
+                timeline.playing = midiClock.isActive() && midiClock.isRunning();
+                timeline.ppqPerSample = midiClock.getPpqPerSample();
+                timeline.ppqStart = midiClock.getPpqPosition() + (blockMs + settings.latencyMs) / 60000.0 * midiClock.getBpm();
+            }
+            else {
+                change = internalTransport.update (true, settings.bpm, blockSamples);
+                timeline.playing = internalTransport.isPlaying();
+                timeline.ppqPerSample = internalTransport.getPpqPerSample();
+                timeline.ppqStart = internalTransport.getPpqPosition();
+            }
+
+            if (change == TransportTracker::Change::stopped || change == TransportTracker::Change::jumped)
+                stopAllNotes (players, outputs);
+
+            auto restarted = change == TransportTracker::Change::started || change == TransportTracker::Change::jumped;
+
+            if (restarted)
+                for (auto& player : players) player.engine.reset();
+
+            for (auto& player : players)
+                playBlock (player, timeline, leadPpq, restarted, player.output->buffer);
+
+            for (auto* output : outputs) {
+                if (! output->buffer.isEmpty())
+                    output->device->sendBlockOfMessages (output->buffer, blockTimeMs, sampleRate);
+
+                output->buffer.clear();
+            }
+
+            if (settings.reportSeconds > 0 && wakeTime - reportStart >= settings.reportSeconds * 1000.0) {
+                printReport (players, wakeTime - reportStart);
+                reportStart = wakeTime;
+            }
+        }
+
+        // don't leave anything hanging
+        stopAllNotes (players, outputs);
+
+        for (auto* output : outputs)
+            output->device->stopBackgroundThread();
+
+        return 0;
+    }
+
+
+    //==============================================================================
+    // runs more and more engines (doubling each time) as fast as they'll go, and
+    // works out from the biggest run how many would fit in one block period
+    int runStressTest (const std::vector<PatternFile>& patterns, const Settings& settings)
+    {
+        auto blockSamples = juce::jmax (16, juce::roundToInt (settings.periodMs * sampleRate / 1000.0));
+        auto blockMs = blockSamples * 1000.0 / sampleRate;
+        auto ticksPerMs = static_cast<double> (juce::Time::getHighResolutionTicksPerSecond()) / 1000.0;
+
+        constexpr double secondsPerRun = 10.0;
+        auto numBlocks = juce::roundToInt (secondsPerRun * 1000.0 / blockMs);
+
+        std::cout << "Playing " << secondsPerRun << " s at " << settings.bpm << " BPM for each run, in "
+                  << juce::String (blockMs, 2) << " ms blocks, on one thread" << std::endl;
+
+        juce::MidiBuffer buffer;
+        buffer.ensureSize (65536);
+
+        auto numEngines = 1;
+        auto meanMs = 0.0, worstMs = 0.0;
+
+        for (;;)
+        {
+            std::vector<Player> players;
+            players.reserve ((size_t) numEngines);
+
+            for (auto i = 0; i < numEngines; ++i)
+                players.emplace_back (patterns[(size_t) i % patterns.size()], Voice(), settings.seed + i);
+
+            InternalTransport transport;
+            transport.prepare (sampleRate);
+            auto leadPpq = getLeadPpq (players);
+
+            juce::int64 totalTicks = 0, worstTicks = 0, numNotes = 0;
+
+            for (auto block = 0; block < numBlocks; ++block) {
+                auto restarted = transport.update (true, settings.bpm, blockSamples) == TransportTracker::Change::started;
+
+                SequencerTimeline timeline;
+                timeline.numSamples = blockSamples;
+                timeline.ppqPerSample = transport.getPpqPerSample();
+                timeline.ppqStart = transport.getPpqPosition();
+
+                auto startTicks = juce::Time::getHighResolutionTicks();
+
+                for (auto& player : players)
+                    playBlock (player, timeline, leadPpq, restarted, buffer);
+
+                auto ticks = juce::Time::getHighResolutionTicks() - startTicks;
+                totalTicks += ticks;
+                worstTicks = juce::jmax (worstTicks, ticks);
+
+                numNotes += buffer.getNumEvents() / 2;
+                buffer.clear();
+            }
+
+            meanMs = static_cast<double> (totalTicks) / ticksPerMs / numBlocks;
+            worstMs = static_cast<double> (worstTicks) / ticksPerMs;
+
+            std::cout << juce::String (numEngines).paddedLeft (' ', 6) << " engines: "
+                      << juce::String (meanMs * 1000.0, 1) << " us per block, worst " << juce::String (worstMs * 1000.0, 1) << " us ("
+                      << juce::String (100.0 * meanMs / blockMs, 2) << " % of a core), " << numNotes << " notes" << std::endl;
+
+            // no point going further once even the average block doesn't fit
+            if (numEngines >= settings.stress || meanMs > blockMs) break;
+            numEngines = juce::jmin (numEngines * 2, settings.stress);
+        }
+
+        auto meanPerEngine = juce::jmax (meanMs, 1.0e-6) / numEngines;
+        auto worstPerEngine = juce::jmax (worstMs, 1.0e-6) / numEngines;
+
+        std::cout << "About " << static_cast<juce::int64> (blockMs / meanPerEngine) << " engines fit in one core, or "
+                  << static_cast<juce::int64> (blockMs / worstPerEngine) << " if the slowest block has to fit as well" << std::endl;
+
+        return 0;
+    }
+
+
+    //==============================================================================
+    int listDevices()
+    {
+        std::cout << "MIDI outputs:" << std::endl;
+        for (auto& device : juce::MidiOutput::getAvailableDevices())
+            std::cout << "  " << device.name << std::endl;
+
+        std::cout << "MIDI inputs (for --clock):" << std::endl;
+        for (auto& device : juce::MidiInput::getAvailableDevices())
+            std::cout << "  " << device.name << std::endl;
+
+        return 0;
+    }
+
+
+    int printUsage()
+    {
+        std::cout << "Usage: ChanceServer --list" << std::endl
+                  << "       ChanceServer [--bpm=120] [--clock=input] [--period=2] [--latency=10]" << std::endl
+                  << "                    [--seconds=0] [--report=10] [--seed=0]" << std::endl
+                  << "                    --midi=output [--channel=1] [--note=36] [--velocity=100] pattern.xml ..." << std::endl
+                  << "       ChanceServer --stress=256 [--bpm=120] [--period=2] pattern.xml ..." << std::endl;
+        return 1;
+    }
+}
+
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    Settings settings;
+    Voice voice;
+    std::vector<std::pair<juce::File, Voice>> entries;
+
+    for (auto i = 1; i < argc; ++i) {
+        juce::String arg (argv[i]);
+
+        if (arg.startsWith ("--")) {
+            auto name = arg.upToFirstOccurrenceOf ("=", false, false);
+            auto value = arg.fromFirstOccurrenceOf ("=", false, false);
+
+            if (name == "--list")           return listDevices();
+            else if (name == "--bpm")       settings.bpm = juce::jlimit (20.0, 300.0, value.getDoubleValue());
+            else if (name == "--clock")     settings.clockInput = value;
+            else if (name == "--period")    settings.periodMs = juce::jlimit (0.5, 20.0, value.getDoubleValue());
+            else if (name == "--latency")   settings.latencyMs = juce::jlimit (0.0, 500.0, value.getDoubleValue());
+            else if (name == "--seconds")   settings.seconds = juce::jmax (0.0, value.getDoubleValue());
+            else if (name == "--report")    settings.reportSeconds = juce::jmax (0.0, value.getDoubleValue());
+            else if (name == "--seed")      settings.seed = value.getLargeIntValue();
+            else if (name == "--stress")    settings.stress = juce::jmax (1, value.getIntValue());
+            else if (name == "--midi")      voice.midiOutput = value;
+            else if (name == "--channel")   voice.channel = juce::jlimit (1, 16, value.getIntValue());
+            else if (name == "--note")      voice.note = juce::jlimit (0, 127, value.getIntValue());
+            else if (name == "--velocity")  voice.velocity = juce::jlimit (1, 127, value.getIntValue());
+            else                            return printUsage();
+        }
+        else {
+            entries.push_back ({ juce::File::getCurrentWorkingDirectory().getChildFile (arg), voice });
+        }
+    }
+
+    if (entries.empty())
+        return printUsage();
+
+    // load all the patterns before anything starts playing
+    std::vector<PatternFile> patterns (entries.size());
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        juce::String error;
+        if (! patterns[i].load (entries[i].first, settings.quarterNotesPerBar, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    if (settings.seed == 0)
+        settings.seed = juce::Random::getSystemRandom().nextInt64();
+
+    if (settings.stress > 0)
+        return runStressTest (patterns, settings);
+
+    // open each output once, however many patterns play on it
+    juce::OwnedArray<Output> outputs;
+    std::vector<Player> players;
+    players.reserve (entries.size());
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto& entryVoice = entries[i].second;
+
+        if (entryVoice.midiOutput.isEmpty()) {
+            std::cerr << "no --midi output for " << entries[i].first.getFileName() << std::endl;
+            return 1;
+        }
+
+        Output* output = nullptr;
+
+        for (auto* o : outputs)
+            if (o->name == entryVoice.midiOutput) output = o;
+
+        if (output == nullptr) {
+            for (auto& device : juce::MidiOutput::getAvailableDevices()) {
+                if (device.name.containsIgnoreCase (entryVoice.midiOutput)) {
+                    output = outputs.add (new Output());
+                    output->name = entryVoice.midiOutput;
+                    output->device = juce::MidiOutput::openDevice (device.identifier);
+                    output->buffer.ensureSize (4096);
+                    break;
+                }
+            }
+
+            if (output == nullptr || output->device == nullptr) {
+                std::cerr << "can't open a MIDI output called " << entryVoice.midiOutput << std::endl;
+                return 1;
+            }
+        }
+
+        players.emplace_back (patterns[i], entryVoice, settings.seed + (juce::int64) i);
+        players.back().output = output;
+    }
+
+    // Ctrl-C (or a service manager) stops it cleanly, so no notes are left hanging
+    std::signal (SIGINT, handleSignal);
+    std::signal (SIGTERM, handleSignal);
+
+    return runServer (players, outputs, settings);
+}
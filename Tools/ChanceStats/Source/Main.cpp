@@ -0,0 +1,299 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 20 Oct 2026 1:36:12pm
+    Author:  Boris Divjak
+
+    ChanceStats - checks that the sequencer fires every step as often as
+    it should. It plays lots of random patterns (every kind of condition
+    and dependency) for hundreds of millions of steps, and compares how
+    often each step fired with what getExpectedRate() says.
+
+    Steps that depend on each other don't fire independently, so the
+    usual binomial error would be too small. Instead each pattern's run is
+    split into batches, and the spread of the rates between batches gives
+    the error (batch means). A step fails if it's further than the bound
+    from its expected rate, in units of that error. Without conditions,
+    a step that only depends on the one before it also has to fire as
+    often as its chance says, which catches a lane that gets stuck.
+
+    Half the patterns reset before the last step, and a few have the same
+    chance on every step.
+
+    Only uses the framework-free engine, so it builds with or without JUCE.
+
+    Usage:
+        ChanceStats [--steps=400000000] [--seed=1] [--bound=6]
+
+    Returns 1 if any step failed.
+
+  ==============================================================================
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <cmath>
+#include <vector>
+#include "../../../Source/SequencerEngine.h"
+#include "../../../Source/ConditionExpression.h"
+
+namespace
+{
+    using Engine = SequencerEngine<16>;
+    using Pattern = Engine::Pattern;
+
+    constexpr int numSteps = Engine::numSteps;
+    constexpr int numBatches = 32;
+    constexpr int blockSize = 64;           // steps per call to the engine
+
+    struct Settings
+    {
+        long long steps = 400000000;
+        std::uint64_t seed = 1;
+        double bound = 6.0;
+    };
+
+    enum class Conditions { none, cycles, expressions };
+
+    const char* getName (Conditions conditions)
+    {
+        return conditions == Conditions::none ? "1:1" : (conditions == Conditions::cycles ? "A:B" : "expressions");
+    }
+
+    const char* getName (Pattern::Dependency dependency)
+    {
+        return dependency == Pattern::Dependency::none ? "none"
+             : (dependency == Pattern::Dependency::previousStep ? "previous step" : "previous step and cycle");
+    }
+
+    struct Configuration
+    {
+        Conditions conditions;
+        Pattern::Dependency dependency;
+        float amount;
+        int reset;
+        std::uint64_t seed;
+        bool flat = false;
+    };
+
+
+    //==============================================================================
+    // a random pattern of the given kind. Some chances are exactly 0 or 1, as they're the edge cases.
+    // A flat pattern has the same chance on every step, which is what could lock a lane at an
+    // amount of -1 or 1.
+    Pattern makePattern (const Configuration& configuration)
+    {
+        static const char* expressions[] = { "!1:4", "prev", "!prev", "prev & 1:2", "prev | 3:4", "not (1:2 or 3:8)", "1:16 | !prev" };
+
+        SequencerRandom random (configuration.seed);
+        Pattern pattern;
+        pattern.stepsPerQuarterNote = 1.0;
+
+        auto flatChance = 0.1f + 0.8f * random.nextFloat();
+
+        for (auto& step : pattern.steps[0]) {
+            auto pick = random.nextFloat();
+            step.chance = configuration.flat ? flatChance : (pick < 0.1f ? 0.0f : (pick < 0.2f ? 1.0f : random.nextFloat()));
+
+            if (configuration.conditions == Conditions::cycles) {
+                static const int denominators[] = { 1, 2, 4, 8, 16 };
+                auto b = denominators[random.next() % 5];
+                step.conditionB = static_cast<std::uint8_t> (b);
+                step.conditionA = static_cast<std::uint8_t> (1 + random.next() % (std::uint64_t) b);
+            }
+            else if (configuration.conditions == Conditions::expressions) {
+                std::string error;
+                ConditionExpression::compile (expressions[random.next() % 7], step.expression, error);
+            }
+        }
+
+        pattern.reset = configuration.reset;
+        pattern.setDependency (configuration.dependency, configuration.amount);
+        return pattern;
+    }
+
+
+    //==============================================================================
+    struct Result
+    {
+        double worst = 0.0;         // largest |error| in units of the standard error
+        double chiSquare = 0.0;     // sum of the squared errors over the steps
+        int failures = 0;
+        double steps = 0.0;         // how many were played...
+        double seconds = 0.0;       // ...and how long that took (not counting the expected rates)
+    };
+
+    Result check (const Configuration& configuration, long long stepsPerConfiguration, const Settings& settings)
+    {
+        auto pattern = makePattern (configuration);
+        Engine engine (configuration.seed * 0x9e3779b97f4a7c15ull + 1);
+
+        // each batch plays whole blocks of whole cycles
+        auto blocksPerBatch = std::max (1LL, stepsPerConfiguration / (numBatches * blockSize));
+
+        std::vector<std::array<long long, numSteps>> fired ((size_t) numBatches);
+        std::vector<std::array<long long, numSteps>> played ((size_t) numBatches);
+        std::array<SequencerEvent, blockSize> events;
+        SequencerTimeline timeline;
+        timeline.ppqPerSample = 1.0;        // one step per sample
+        timeline.numSamples = blockSize;
+
+        long long block = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto batch = 0; batch < numBatches; ++batch) {
+            auto& counts = fired[(size_t) batch];
+            auto& trials = played[(size_t) batch];
+            counts.fill (0);
+            trials.fill (0);
+
+            for (long long i = 0; i < blocksPerBatch; ++i, ++block) {
+                timeline.ppqStart = static_cast<double> (block * blockSize);
+                auto numEvents = engine.process (pattern, timeline, events.data(), blockSize);
+
+                for (auto e = 0; e < numEvents; ++e) {
+                    auto step = (size_t) events[(size_t) e].step;
+                    counts[step] += events[(size_t) e].fired ? 1 : 0;
+                    ++trials[step];
+                }
+            }
+        }
+
+        Result result;
+        result.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+        result.steps = static_cast<double> (block * blockSize);
+        auto expectedRates = pattern.getExpectedRates (0);
+
+        // the chain of steps is only as random as their chances when nothing else decides
+        auto firesAtChance = configuration.conditions == Conditions::none
+                          && configuration.dependency != Pattern::Dependency::previousStepAndCycle;
+
+        for (auto step = 0; step < numSteps; ++step) {
+            auto expected = expectedRates[(size_t) step];
+            auto mean = 0.0, squares = 0.0, trials = 0.0;
+
+            for (auto batch = 0; batch < numBatches; ++batch) {
+                auto count = static_cast<double> (played[(size_t) batch][(size_t) step]);
+                auto rate = count > 0.0 ? static_cast<double> (fired[(size_t) batch][(size_t) step]) / count : 0.0;
+                mean += rate;
+                squares += rate * rate;
+                trials += count;
+            }
+
+            mean /= numBatches;
+            auto variance = std::max (0.0, (squares / numBatches - mean * mean) * numBatches / (numBatches - 1));
+
+            // the batches can look steadier than they are when a step hardly ever (or almost
+            // always) fires, so the error is never taken to be less than for independent rolls
+            auto independent = trials > 0.0 ? expected * (1.0 - expected) / trials : 0.0;
+            auto error = std::sqrt (std::max (variance / numBatches, independent));
+
+            // a step that always does the same thing has to do exactly what's expected
+            auto deviationFrom = [&] (double rate) {
+                return error > 0.0 ? std::abs (mean - rate) / error
+                                   : (std::abs (mean - rate) < 1.0e-9 ? 0.0 : 1.0e9);
+            };
+
+            auto deviation = deviationFrom (expected);
+
+            if (firesAtChance && trials > 0.0) {
+                auto chance = static_cast<double> (std::clamp (pattern.steps[0][(size_t) step].chance, 0.0f, 1.0f));
+                deviation = std::max (deviation, deviationFrom (chance));
+            }
+
+            result.worst = std::max (result.worst, deviation);
+            result.chiSquare += deviation * deviation;
+
+            if (deviation > settings.bound) {
+                ++result.failures;
+                std::printf ("  FAIL %s, %s %.2f, reset %d, seed %llu, step %d: %.6f fired, %.6f expected, chance %.6f (%.1f standard errors)\n",
+                             getName (configuration.conditions), getName (configuration.dependency), configuration.amount,
+                             configuration.reset, (unsigned long long) configuration.seed, step + 1, mean, expected,
+                             (double) pattern.steps[0][(size_t) step].chance, deviation);
+            }
+        }
+
+        return result;
+    }
+
+
+    int printUsage ()
+    {
+        std::printf ("Usage: ChanceStats [--steps=400000000] [--seed=1] [--bound=6]\n");
+        return 1;
+    }
+}
+
+
+//==============================================================================
+
+
+int main (int argc, char* argv[])
+{
+    Settings settings;
+
+    for (auto i = 1; i < argc; ++i) {
+        std::string arg (argv[i]);
+        auto equals = arg.find ('=');
+        auto name = arg.substr (0, equals);
+        auto value = equals == std::string::npos ? std::string() : arg.substr (equals + 1);
+
+        if (name == "--steps")      settings.steps = std::max (1000000LL, std::atoll (value.c_str()));
+        else if (name == "--seed")  settings.seed = std::strtoull (value.c_str(), nullptr, 10);
+        else if (name == "--bound") settings.bound = std::max (1.0, std::atof (value.c_str()));
+        else                        return printUsage();
+    }
+
+    // every kind of condition with every kind of dependency, a few patterns each,
+    // every other one resetting early
+    std::vector<Configuration> configurations;
+    const float amounts[] = { -1.0f, -0.5f, 0.5f, 1.0f };
+    const int resets[] = { 8, 5, 12, 3 };
+    constexpr int patternsEach = 4;
+    std::uint64_t seed = settings.seed;
+
+    auto getReset = [&] (int i) { return i % 2 == 0 ? numSteps : resets[(seed + (std::uint64_t) i) % 4]; };
+
+    for (auto conditions : { Conditions::none, Conditions::cycles, Conditions::expressions }) {
+        for (auto i = 0; i < patternsEach; ++i)
+            configurations.push_back ({ conditions, Pattern::Dependency::none, 0.0f, getReset (i), seed++ });
+
+        for (auto dependency : { Pattern::Dependency::previousStep, Pattern::Dependency::previousStepAndCycle })
+            for (auto amount : amounts)
+                for (auto i = 0; i < patternsEach; ++i)
+                    configurations.push_back ({ conditions, dependency, amount, getReset (i), seed++ });
+    }
+
+    for (auto amount : { -1.0f, 1.0f })
+        for (auto i = 0; i < patternsEach; ++i)
+            configurations.push_back ({ Conditions::none, Pattern::Dependency::previousStep, amount, getReset (i), seed++, true });
+
+    auto stepsEach = settings.steps / static_cast<long long> (configurations.size());
+    auto failures = 0;
+    auto worst = 0.0;
+    auto worstChiSquare = 0.0;
+    auto played = 0.0, seconds = 0.0;
+
+    std::printf ("%d patterns, %lld steps each, failing beyond %.1f standard errors\n",
+                 (int) configurations.size(), stepsEach, settings.bound);
+
+    for (auto& configuration : configurations) {
+        auto result = check (configuration, stepsEach, settings);
+        failures += result.failures;
+        worst = std::max (worst, result.worst);
+        worstChiSquare = std::max (worstChiSquare, result.chiSquare);
+        played += result.steps;
+        seconds += result.seconds;
+    }
+
+    // with 16 steps per pattern, the chi-square should mostly stay under about 32
+    std::printf ("%.0f steps in %.1f s (%.1fM steps/s), worst step %.2f standard errors, worst pattern chi-square %.1f (16 dof)\n",
+                 played, seconds, played / seconds / 1.0e6, worst, worstChiSquare);
+    std::printf (failures == 0 ? "All steps fire as often as expected\n" : "%d steps failed\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
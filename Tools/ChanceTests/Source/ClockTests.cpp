@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    ClockTests.cpp
+    Created: 20 Oct 2026 9:21:06am
+    Author:  Boris Divjak
+
+    Feeds the MIDI clock follower synthetic clock with random timing
+    jitter, like a cheap USB interface would give, and checks how far its
+    position is from where the clock really is. The clock generator is
+    checked the other way round: every tick it sends has to land on the
+    sample where it's due, whatever size the blocks are.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/MIDIClockFollower.h"
+#include "../../../Source/MIDIClockGenerator.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256;
+    constexpr double bpm = 128.0;
+
+    // Gaussian noise (Box-Muller), in samples
+    double gaussian (juce::Random& random, double deviation)
+    {
+        auto u1 = juce::jmax (1.0e-12, random.nextDouble());
+        auto u2 = random.nextDouble();
+        return deviation * std::sqrt (-2.0 * std::log (u1)) * std::cos (juce::MathConstants<double>::twoPi * u2);
+    }
+}
+
+
+//==============================================================================
+
+
+class MIDIClockFollowerTests  : public juce::UnitTest
+{
+public:
+    MIDIClockFollowerTests() : juce::UnitTest ("MIDI clock follower", "Clock") {}
+
+    void runTest() override
+    {
+        // where the DLL should get to with a steady clock, 1 ms and 3 ms of jitter. The
+        // worst case is bigger, as the position waits for a tick that comes in late
+        followClock (0.0, 0.05, 0.5);
+        followClock (1.0, 0.5, 6.0);
+        followClock (3.0, 1.0, 12.0);
+    }
+
+private:
+    void followClock (double jitterMs, double maxMeanErrorMs, double maxErrorMs)
+    {
+        beginTest ("Follows clock with " + juce::String (jitterMs) + " ms of jitter");
+
+        auto random = getRandom();
+        auto tickInterval = sampleRate * 60.0 / bpm / 24.0;
+        auto jitter = jitterMs * sampleRate / 1000.0;
+        auto firstTick = 100.0;
+
+        MIDIClockFollower follower;
+        follower.prepare (sampleRate);
+
+        juce::MidiBuffer buffer;
+        juce::int64 tick = 0;
+        auto nextTickTime = firstTick;
+
+        auto errorSum = 0.0;
+        auto maxError = 0.0;
+        auto numMeasured = 0;
+        auto lastPpq = 0.0;
+        auto wentBackwards = false;
+
+        // a minute of clock, ignoring the first 2 seconds while the loop settles
+        auto numBlocks = static_cast<int> (60.0 * sampleRate / blockSize);
+        auto settleBlocks = static_cast<int> (2.0 * sampleRate / blockSize);
+
+        for (auto block = 0; block < numBlocks; ++block) {
+            auto blockStart = static_cast<juce::int64> (block) * blockSize;
+            buffer.clear();
+
+            if (block == 0) buffer.addEvent (juce::MidiMessage::midiStart(), 0);
+
+            while (nextTickTime < static_cast<double> (blockStart + blockSize)) {
+                buffer.addEvent (juce::MidiMessage::midiClock(), static_cast<int> (nextTickTime) - static_cast<int> (blockStart));
+
+                // keep the ticks in order, however unlucky the jitter is
+                ++tick;
+                auto offset = juce::jlimit (-0.4 * tickInterval, 0.4 * tickInterval, gaussian (random, jitter));
+                nextTickTime = juce::jmax (nextTickTime + 1.0, firstTick + static_cast<double> (tick) * tickInterval + offset);
+            }
+
+            follower.update (buffer, blockSize);
+
+            if (follower.getPpqPosition() < lastPpq) wentBackwards = true;
+            lastPpq = follower.getPpqPosition();
+
+            if (block < settleBlocks) continue;
+
+            auto truePpq = (static_cast<double> (blockStart) - firstTick) / (tickInterval * 24.0);
+            auto errorMs = std::abs (follower.getPpqPosition() - truePpq) * 60000.0 / bpm;
+
+            errorSum += errorMs;
+            maxError = juce::jmax (maxError, errorMs);
+            ++numMeasured;
+        }
+
+        auto meanError = errorSum / numMeasured;
+        logMessage ("mean error " + juce::String (meanError, 3) + " ms, worst " + juce::String (maxError, 3)
+                    + " ms, " + juce::String (follower.getBpm(), 2) + " BPM");
+
+        expect (! wentBackwards, "the position went backwards");
+        expectLessThan (meanError, maxMeanErrorMs);
+        expectLessThan (maxError, maxErrorMs);
+        expectWithinAbsoluteError (follower.getBpm(), bpm, 0.5);
+    }
+};
+
+static MIDIClockFollowerTests midiClockFollowerTests;
+
+
+//==============================================================================
+
+
+class MIDIClockGeneratorTests  : public juce::UnitTest
+{
+public:
+    MIDIClockGeneratorTests() : juce::UnitTest ("MIDI clock generator", "Clock") {}
+
+    void runTest() override
+    {
+        sendClock (false);
+        sendClock (true);
+    }
+
+private:
+    void sendClock (bool randomBlockSizes)
+    {
+        beginTest (randomBlockSizes ? "Sends sample accurate clock with changing block sizes"
+                                    : "Sends sample accurate clock");
+
+        auto random = getRandom();
+        auto ppqPerSample = bpm / (60.0 * sampleRate);
+        auto samplesPerTick = 1.0 / (ppqPerSample * 24.0);
+
+        MIDIClockGenerator generator;
+        MIDIClockFollower follower;
+        follower.prepare (sampleRate);
+
+        juce::MidiBuffer buffer;
+        juce::int64 blockStart = 0;
+        juce::int64 tick = 0;
+        auto maxError = 0.0;
+        auto startedFirst = false;
+
+        // a minute of clock, which is also played back into the follower
+        while (blockStart < static_cast<juce::int64> (60.0 * sampleRate)) {
+            SequencerTimeline timeline;
+            timeline.ppqStart = static_cast<double> (blockStart) * ppqPerSample;
+            timeline.ppqPerSample = ppqPerSample;
+            timeline.numSamples = randomBlockSizes ? 1 + random.nextInt (1024) : blockSize;
+
+            buffer.clear();
+            generator.process (timeline, blockStart == 0 ? TransportTracker::Change::started
+                                                         : TransportTracker::Change::none, buffer);
+
+            for (const auto metadata : buffer) {
+                auto message = metadata.getMessage();
+
+                if (message.isMidiStart() && tick == 0) startedFirst = true;
+                if (! message.isMidiClock()) continue;
+
+                // ticks can only be late (by less than a sample), never early
+                auto time = static_cast<double> (blockStart + metadata.samplePosition);
+                auto error = time - static_cast<double> (tick) * samplesPerTick;
+                expect (error >= 0.0, "tick " + juce::String (tick) + " is early");
+                maxError = juce::jmax (maxError, error);
+                ++tick;
+            }
+
+            follower.update (buffer, timeline.numSamples);
+            blockStart += timeline.numSamples;
+        }
+
+        logMessage (juce::String (tick) + " ticks, worst " + juce::String (maxError, 3) + " samples late");
+
+        expect (startedFirst, "no Start before the first tick");
+        expectLessThan (maxError, 1.0);
+        expectWithinAbsoluteError (static_cast<double> (tick), static_cast<double> (blockStart) / samplesPerTick, 1.0);
+        expectWithinAbsoluteError (follower.getBpm(), bpm, 0.1);
+    }
+};
+
+static MIDIClockGeneratorTests midiClockGeneratorTests;
@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 20 Oct 2026 9:14:52am
+    Author:  Boris Divjak
+
+    ChanceTests - unit tests and benchmarks for the plugin's parts, built
+    from the same source files as the plugin. Each test is a juce::UnitTest
+    in one of the files next to this one, and registers itself.
+
+    Usage:
+        ChanceTests [--category=Clock] [--seed=0]
+
+    Returns 1 if anything failed, so it can be run from scripts.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::String category;
+    juce::int64 seed = 0;
+
+    for (auto i = 1; i < argc; ++i) {
+        juce::String arg (argv[i]);
+        auto name = arg.upToFirstOccurrenceOf ("=", false, false);
+        auto value = arg.fromFirstOccurrenceOf ("=", false, false);
+
+        if (name == "--category")   category = value;
+        else if (name == "--seed")  seed = value.getLargeIntValue();
+        else {
+            std::cout << "Usage: ChanceTests [--category=name] [--seed=0]" << std::endl << "Categories:";
+            for (auto& c : juce::UnitTest::getAllCategories()) std::cout << " " << c;
+            std::cout << std::endl;
+            return 1;
+        }
+    }
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+
+    // 0 picks a random seed (which is printed, so a failure can be repeated)
+    if (category.isNotEmpty())  runner.runTestsInCategory (category, seed);
+    else                        runner.runAllTests (seed);
+
+    auto failures = 0;
+    for (auto i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult (i)->failures;
+
+    return failures > 0 ? 1 : 0;
+}
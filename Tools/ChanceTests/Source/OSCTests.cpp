@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    OSCTests.cpp
+    Created: 21 Oct 2026 11:26:40am
+    Author:  Boris Divjak
+
+    Checks the OSC event sender's time tags, and times how long events take
+    to get from the audio thread side of the sender to a receiver on the
+    same machine (which is most of what a visualiser would see of it).
+    Needs the loopback network, and a free UDP port.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/OSCEventSender.h"
+
+namespace
+{
+    // one 2^-32 s unit of an OSC time tag, in milliseconds
+    constexpr double timeTagUnitMs = 1000.0 / 4294967296.0;
+
+    // counts what comes in, on the receiver's own thread
+    struct LatencyReceiver  : juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
+    {
+        void oscMessageReceived (const juce::OSCMessage&) override {}
+
+        void oscBundleReceived (const juce::OSCBundle&) override
+        {
+            receivedAt = juce::Time::getMillisecondCounterHiRes();
+            received.signal();
+        }
+
+        std::atomic<double> receivedAt { 0.0 };
+        juce::WaitableEvent received;
+    };
+}
+
+
+//==============================================================================
+
+
+class OSCEventSenderTests  : public juce::UnitTest
+{
+public:
+    OSCEventSenderTests() : juce::UnitTest ("OSC event sender", "OSC") {}
+
+    void runTest() override
+    {
+        beginTest ("Time tags");
+        {
+            auto timeMs = 1760000000123.0;
+            auto tag = OSCEventSender::toTimeTag (timeMs);
+
+            expectEquals (tag.toTime().toMilliseconds(), static_cast<juce::int64> (timeMs));
+
+            // fractions of a millisecond make it into the tag
+            for (auto offset : { 0.01, 0.25, 0.5, 0.999 }) {
+                auto later = OSCEventSender::toTimeTag (timeMs + offset);
+                auto difference = static_cast<double> (later.getRawTimeTag() - tag.getRawTimeTag()) * timeTagUnitMs;
+                expectWithinAbsoluteError (difference, offset, 0.001);
+            }
+        }
+
+        beginTest ("Loopback latency");
+        {
+            juce::OSCReceiver receiver;
+            LatencyReceiver listener;
+            auto port = 0;
+
+            for (auto attempt = 0; attempt < 20 && port == 0; ++attempt) {
+                auto p = 20000 + getRandom().nextInt (20000);
+                if (receiver.connect (p)) port = p;
+            }
+
+            expect (port > 0, "no free UDP port");
+            if (port == 0) return;
+
+            receiver.addListener (&listener);
+
+            OSCEventSender sender;
+            sender.setPort (port);
+
+            // one event a block, the same way the processor sends them
+            auto sendOne = [&sender, &listener] (int step) {
+                listener.received.reset();
+                auto sentAt = juce::Time::getMillisecondCounterHiRes();
+                sender.addStep (static_cast<double> (juce::Time::currentTimeMillis()), step, true, 0);
+                sender.endBlock();
+                return listener.received.wait (1000) ? listener.receivedAt.load() - sentAt : -1.0;
+            };
+
+            // the first one waits for the sender to connect
+            sendOne (0);
+
+            constexpr int numEvents = 200;
+            auto total = 0.0, worst = 0.0;
+            auto numReceived = 0;
+
+            for (auto i = 0; i < numEvents; ++i) {
+                auto latency = sendOne (i % 16);
+                if (latency < 0) continue;
+
+                total += latency;
+                worst = juce::jmax (worst, latency);
+                ++numReceived;
+            }
+
+            receiver.removeListener (&listener);
+            receiver.disconnect();
+
+            logMessage ("received " + juce::String (numReceived) + " / " + juce::String (numEvents)
+                        + ", average " + juce::String (total / juce::jmax (1, numReceived), 3) + " ms, worst " + juce::String (worst, 3) + " ms");
+
+            // loopback UDP shouldn't lose anything, and the sender thread checks every millisecond
+            expectEquals (numReceived, numEvents);
+            expectLessThan (total / juce::jmax (1, numReceived), 10.0);
+        }
+    }
+};
+
+static OSCEventSenderTests oscEventSenderTests;
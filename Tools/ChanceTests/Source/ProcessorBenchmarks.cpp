@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    ProcessorBenchmarks.cpp
+    Created: 20 Oct 2026 10:02:37am
+    Author:  Boris Divjak
+
+    Times the things hosts do to the plugin a lot: making instances (a
+    project with dozens of them, or a host scanning plugins), asking for
+    parameter text, opening the editor - and forwarding dense MIDI through
+    processBlock, which is what it does all the time. The numbers
+    are printed, and only checked against limits loose enough that a slow
+    build machine won't fail them.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/PluginEditor.h"
+
+namespace
+{
+    // runs the function count times, and returns how long each one took on average, in microseconds
+    template <typename Function>
+    double timeEach (int count, Function&& function)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (auto i = 0; i < count; ++i)
+            function (i);
+
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) * 1.0e6 / count;
+    }
+
+    // a host that's playing, at a steady tempo
+    struct PlayingHost  : juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setIsPlaying (true);
+            info.setBpm (bpm);
+            info.setPpqPosition (ppq);
+            info.setTimeSignature (juce::AudioPlayHead::TimeSignature { 4, 4 });
+            return info;
+        }
+
+        void advance (int numSamples, double sampleRate)    { ppq += numSamples * bpm / 60.0 / sampleRate; }
+
+        double bpm = 120.0;
+        double ppq = 0.0;
+    };
+}
+
+
+//==============================================================================
+
+
+class ProcessorBenchmarks  : public juce::UnitTest
+{
+public:
+    ProcessorBenchmarks() : juce::UnitTest ("Processor benchmarks", "Benchmarks") {}
+
+    void runTest() override
+    {
+        beginTest ("Creating instances");
+
+        constexpr int numInstances = 100;
+
+        // the device scan is left to the message thread, so it isn't part of this
+        auto created = timeEach (numInstances, [] (int) {
+            ChanceMachineAudioProcessor processor;
+        });
+
+        // ...and this is what it would cost if it was still done straight away
+        auto scanned = timeEach (numInstances, [] (int) {
+            ChanceMachineAudioProcessor processor;
+            processor.midiRouter.updateDeviceList (true);
+        });
+
+        logMessage ("create and delete: " + juce::String (created, 1) + " us, with a device scan: "
+                    + juce::String (scanned, 1) + " us");
+
+        expectLessThan (created, 20000.0);
+
+
+        beginTest ("Parameter text");
+
+        // hosts and controller displays ask for these all the time
+        constexpr int numTexts = 200000;
+        ChanceMachineAudioProcessor textProcessor;
+        auto* chance = textProcessor.state.getParameter ("chance0");
+
+        auto shared = timeEach (numTexts, [chance] (int i) {
+            auto text = chance->getText (static_cast<float> (i % 101) / 100.0f, 32);
+            juce::ignoreUnused (text);
+        });
+
+        // what it did before the texts were shared: a new string every time
+        auto made = timeEach (numTexts, [] (int i) {
+            auto text = juce::String (juce::roundToInt (static_cast<float> (i % 101)));
+            juce::ignoreUnused (text);
+        });
+
+        logMessage ("percent text from the table: " + juce::String (shared * 1000.0, 1) + " ns, made each time: "
+                    + juce::String (made * 1000.0, 1) + " ns");
+
+        expectEquals (chance->getText (0.5f, 32), juce::String ("50"));
+        expectLessThan (shared, 5.0);
+
+
+        beginTest ("Forwarding MIDI");
+
+        // a block full of notes, CCs and pitch bend, all to be forwarded (the default send out mode)
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+        constexpr int eventsPerBlock = 1024;
+        constexpr int numBlocks = 2000;
+
+        juce::MidiBuffer events;
+        for (auto i = 0; i < eventsPerBlock; ++i) {
+            auto position = i * blockSize / eventsPerBlock;
+            auto note = 36 + (i / 4) % 48;
+
+            switch (i % 4) {
+                case 0:  events.addEvent (juce::MidiMessage::noteOn (1, note, (juce::uint8) 100), position); break;
+                case 1:  events.addEvent (juce::MidiMessage::controllerEvent (1, 74, i % 128), position); break;
+                case 2:  events.addEvent (juce::MidiMessage::pitchWheel (1, (i * 37) % 16384), position); break;
+                default: events.addEvent (juce::MidiMessage::noteOff (1, note), position); break;
+            }
+        }
+
+        ChanceMachineAudioProcessor forwarder;
+        PlayingHost host;
+        forwarder.setPlayHead (&host);
+        forwarder.prepareToPlay (sampleRate, blockSize);
+
+        juce::AudioBuffer<float> audio (2, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize (eventsPerBlock * 8);
+        auto numForwarded = 0;
+
+        // refilling the buffer is part of it, as it would be in a host
+        auto perBlock = timeEach (numBlocks, [&] (int) {
+            midi.clear();
+            midi.addEvents (events, 0, blockSize, 0);
+            forwarder.processBlock (audio, midi);
+            host.advance (blockSize, sampleRate);
+            numForwarded = midi.getNumEvents();
+        });
+
+        forwarder.releaseResources();
+        forwarder.setPlayHead (nullptr);
+
+        logMessage (juce::String (eventsPerBlock) + " events per block: " + juce::String (perBlock, 1) + " us per block ("
+                    + juce::String (perBlock * 1000.0 / eventsPerBlock, 1) + " ns per event), "
+                    + juce::String (numForwarded) + " events out of the last block");
+
+        // every chance is 100% by default, so everything comes out again
+        expect (numForwarded >= eventsPerBlock, "events went missing");
+        expectLessThan (perBlock, blockSize / sampleRate * 1.0e6);
+
+
+        beginTest ("Opening the editor");
+
+        constexpr int numEditors = 50;
+        ChanceMachineAudioProcessor processor;
+
+        // all the dropdowns (conditions, programs...) are only filled in when they're clicked
+        auto opened = timeEach (numEditors, [&processor] (int) {
+            std::unique_ptr<juce::AudioProcessorEditor> editor (processor.createEditor());
+        });
+
+        logMessage ("open and close the editor: " + juce::String (opened / 1000.0, 2) + " ms");
+
+        expectLessThan (opened, 100000.0);
+    }
+};
+
+static ProcessorBenchmarks processorBenchmarks;
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    RingLatencyBenchmarks.cpp
+    Created: 21 Oct 2026 2:05:18pm
+    Author:  Boris Divjak
+
+    Compares the two ways events leave the plugin for other programs on
+    the same machine: the shared memory ring (what 'Share' turns on), and
+    a MIDI device, sent the way MIDIOutputRouter sends blocks to one. Each
+    event is timed from being handed over to arriving at the other end.
+
+    The ring reader here polls without sleeping, so this is the best the
+    ring can do - ChanceRingReader sleeps for a millisecond between polls.
+    The MIDI path needs a virtual device (macOS and Linux only).
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/SharedEventRing.h"
+
+namespace
+{
+    constexpr int numLatencyEvents = 500;
+
+    // the same thing either way: when the last event arrived, for the sending side to wait on
+    struct Arrivals
+    {
+        void arrived()
+        {
+            receivedAt = juce::Time::getMillisecondCounterHiRes();
+            received.signal();
+        }
+
+        // how long it took for the next event to arrive after calling send, or -1 if it didn't
+        template <typename SendFunction>
+        double time (SendFunction&& send)
+        {
+            received.reset();
+            auto sentAt = juce::Time::getMillisecondCounterHiRes();
+            send (sentAt);
+            return received.wait (1000) ? receivedAt.load() - sentAt : -1.0;
+        }
+
+        std::atomic<double> receivedAt { 0.0 };
+        juce::WaitableEvent received;
+    };
+
+    struct LatencyStats
+    {
+        void add (double ms)
+        {
+            if (ms < 0) { ++lost; return; }
+
+            total += ms;
+            worst = juce::jmax (worst, ms);
+            ++count;
+        }
+
+        double getAverage() const   { return total / juce::jmax (1, count); }
+
+        juce::String toString() const
+        {
+            return "average " + juce::String (getAverage(), 3) + " ms, worst " + juce::String (worst, 3)
+                   + " ms (" + juce::String (count) + " events, " + juce::String (lost) + " lost)";
+        }
+
+        double total = 0, worst = 0;
+        int count = 0, lost = 0;
+    };
+
+    juce::MidiBuffer makeBlock()
+    {
+        juce::MidiBuffer block;
+        block.addEvent (juce::MidiMessage::noteOn (1, 60, (juce::uint8) 100), 0);
+        return block;
+    }
+}
+
+
+//==============================================================================
+
+
+class RingLatencyBenchmarks  : public juce::UnitTest
+{
+public:
+    RingLatencyBenchmarks() : juce::UnitTest ("Shared ring vs MIDI device latency", "Benchmarks") {}
+
+    void runTest() override
+    {
+        auto block = makeBlock();
+
+        beginTest ("Shared ring");
+
+        LatencyStats ring;
+        {
+            SharedEventRing writer, reader;
+            expect (writer.create(), "couldn't create a ring");
+            expect (reader.openForReading (writer.getRingNumber()), "couldn't open the ring");
+            if (! writer.isOpen() || ! reader.isOpen()) return;
+
+            Arrivals arrivals;
+            std::atomic<bool> reading { true };
+
+            std::thread readerThread ([&] {
+                SharedEventRing::Event event;
+
+                while (reading) {
+                    if (reader.read (&event, 1) > 0)    arrivals.arrived();
+                    else                                std::this_thread::yield();
+                }
+            });
+
+            for (auto i = 0; i < numLatencyEvents; ++i)
+                ring.add (arrivals.time ([&] (double now) { writer.publish (block, now, 48000.0); }));
+
+            reading = false;
+            readerThread.join();
+        }
+
+        logMessage ("shared ring: " + ring.toString());
+        expectEquals (ring.lost, 0);
+
+
+        beginTest ("MIDI device");
+
+        struct Input  : juce::MidiInputCallback
+        {
+            void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage&) override   { arrivals.arrived(); }
+            Arrivals arrivals;
+        } callback;
+
+        auto input = juce::MidiInput::createNewDevice ("ChanceTests loopback", &callback);
+
+        if (input == nullptr) {
+            logMessage ("can't make a virtual MIDI device here, so there's nothing to compare with");
+            return;
+        }
+
+        input->start();
+
+        std::unique_ptr<juce::MidiOutput> output;
+        for (auto& device : juce::MidiOutput::getAvailableDevices())
+            if (device.name == input->getName())
+                output = juce::MidiOutput::openDevice (device.identifier);
+
+        expect (output != nullptr, "can't send to the virtual MIDI device");
+        if (output == nullptr) return;
+
+        // blocks are sent by the device's own thread, when they're due (like the router does)
+        output->startBackgroundThread();
+
+        LatencyStats device;
+        for (auto i = 0; i < numLatencyEvents; ++i)
+            device.add (callback.arrivals.time ([&] (double now) { output->sendBlockOfMessages (block, now, 48000.0); }));
+
+        output->stopBackgroundThread();
+        input->stop();
+
+        logMessage ("MIDI device: " + device.toString());
+        logMessage ("the ring is " + juce::String (device.getAverage() / juce::jmax (1.0e-6, ring.getAverage()), 1) + " times quicker on average");
+    }
+};
+
+static RingLatencyBenchmarks ringLatencyBenchmarks;
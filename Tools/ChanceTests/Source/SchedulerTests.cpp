@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    SchedulerTests.cpp
+    Created: 20 Oct 2026 11:18:44am
+    Author:  Boris Divjak
+
+    Checks that the event scheduler gives events back in time order (and
+    in the order they went in, for the same time), says so when it's
+    full, and times it with as many events waiting as a busy pattern has.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/EventScheduler.h"
+
+namespace
+{
+    struct TestEvent
+    {
+        std::int64_t time;
+        int order;
+    };
+}
+
+
+//==============================================================================
+
+
+class EventSchedulerTests  : public juce::UnitTest
+{
+public:
+    EventSchedulerTests() : juce::UnitTest ("Event scheduler", "Scheduler") {}
+
+    void runTest() override
+    {
+        beginTest ("Events come out in time order");
+        {
+            auto random = getRandom();
+            EventScheduler<TestEvent, 256> scheduler;
+
+            for (auto i = 0; i < 256; ++i) {
+                auto time = static_cast<std::int64_t> (random.nextInt (64));
+                expect (scheduler.schedule (time, { time, i }));
+            }
+
+            expect (! scheduler.schedule (0, { 0, 256 }), "a full queue took another event");
+            expectEquals (scheduler.size(), 256);
+
+            TestEvent previous { -1, -1 };
+            auto inOrder = true;
+
+            scheduler.processUntil (64, [&] (std::int64_t time, const TestEvent& event) {
+                inOrder = inOrder && time == event.time
+                          && (time > previous.time || (time == previous.time && event.order > previous.order));
+                previous = event;
+            });
+
+            expect (inOrder);
+            expect (scheduler.isEmpty());
+        }
+
+        beginTest ("Events wait for their block");
+        {
+            EventScheduler<TestEvent, 16> scheduler;
+            scheduler.schedule (1000, { 1000, 0 });
+            scheduler.schedule (10, { 10, 1 });
+
+            auto count = 0;
+            scheduler.processUntil (512, [&] (std::int64_t, const TestEvent&) { ++count; });
+            expectEquals (count, 1);
+
+            // handlers can schedule more (e.g. a note off), which come out in the same call if they're due
+            scheduler.processUntil (2048, [&] (std::int64_t time, const TestEvent& event) {
+                ++count;
+                if (event.order == 0) scheduler.schedule (time + 100, { time + 100, 2 });
+            });
+            expectEquals (count, 3);
+        }
+    }
+};
+
+static EventSchedulerTests eventSchedulerTests;
+
+
+//==============================================================================
+
+
+class EventSchedulerBenchmarks  : public juce::UnitTest
+{
+public:
+    EventSchedulerBenchmarks() : juce::UnitTest ("Event scheduler benchmarks", "Benchmarks") {}
+
+    void runTest() override
+    {
+        // a couple of bars of 16 steps with 8 ratchets each, and a full queue
+        for (auto depth : { 16, 256, 1000 })
+            run (depth);
+    }
+
+private:
+    void run (int depth)
+    {
+        beginTest ("Scheduling with " + juce::String (depth) + " events waiting");
+
+        constexpr int blockSize = 256;
+        constexpr int numEvents = 10000000;
+
+        auto random = getRandom();
+        EventScheduler<TestEvent, 1024> scheduler;
+        std::int64_t now = 0;
+        std::int64_t checksum = 0;
+
+        // keep the queue at the same depth: every event that comes out is replaced by a later one
+        for (auto i = 0; i < depth; ++i)
+            scheduler.schedule (random.nextInt (blockSize * 64), { 0, i });
+
+        auto handled = 0;
+        auto start = juce::Time::getHighResolutionTicks();
+
+        while (handled < numEvents) {
+            now += blockSize;
+
+            scheduler.processUntil (now, [&] (std::int64_t time, const TestEvent& event) {
+                checksum += time + event.order;
+                scheduler.schedule (time + 1 + random.nextInt (blockSize * 64), event);
+                ++handled;
+            });
+        }
+
+        auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+        logMessage (juce::String (seconds * 1.0e9 / handled, 1) + " ns per event (" + juce::String (checksum % 10) + ")");
+
+        expectEquals (scheduler.size(), depth);
+    }
+};
+
+static EventSchedulerBenchmarks eventSchedulerBenchmarks;
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    SequencerBenchmarks.cpp
+    Created: 20 Oct 2026 4:12:05pm
+    Author:  Boris Divjak
+
+    Times the sequencer engine rolling its steps: with every step's chance
+    on its own, and with the chance looked up by what the step before (and
+    this step last cycle) did. The lookup should hardly cost anything over
+    the plain roll.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/SequencerEngine.h"
+
+
+//==============================================================================
+
+
+class SequencerBenchmarks  : public juce::UnitTest
+{
+public:
+    SequencerBenchmarks() : juce::UnitTest ("Sequencer benchmarks", "Benchmarks") {}
+
+    void runTest() override
+    {
+        beginTest ("Dependent chances");
+
+        auto plain = run (Pattern::Dependency::none);
+        auto previous = run (Pattern::Dependency::previousStep);
+        auto cycle = run (Pattern::Dependency::previousStepAndCycle);
+
+        logMessage ("plain roll: " + juce::String (plain, 2) + " ns per step, after the step before: "
+                    + juce::String (previous, 2) + " ns, and last cycle: " + juce::String (cycle, 2) + " ns");
+
+        // loose enough for a slow or busy build machine
+        expectLessThan (previous, plain * 2.0 + 5.0);
+        expectLessThan (cycle, plain * 2.0 + 5.0);
+    }
+
+private:
+    using Engine = SequencerEngine<16>;
+    using Pattern = Engine::Pattern;
+
+    // plays lots of steps with the given dependency, and returns how long each one took, in nanoseconds
+    double run (Pattern::Dependency dependency)
+    {
+        constexpr int blockSize = 256;      // steps per call to the engine
+        constexpr int numBlocks = 40000;
+
+        auto random = getRandom();
+        Pattern pattern;
+        pattern.stepsPerQuarterNote = 1.0;
+
+        for (auto& step : pattern.steps[0])
+            step.chance = random.nextFloat();
+
+        pattern.setDependency (dependency, 0.5f);
+
+        Engine engine (1);
+        std::array<SequencerEvent, blockSize> events;
+        SequencerTimeline timeline;
+        timeline.ppqPerSample = 1.0;        // one step per sample
+        timeline.numSamples = blockSize;
+        auto fired = 0;
+
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (auto block = 0; block < numBlocks; ++block) {
+            timeline.ppqStart = static_cast<double> (block) * blockSize;
+            auto numEvents = engine.process (pattern, timeline, events.data(), blockSize);
+
+            for (auto e = 0; e < numEvents; ++e)
+                fired += events[(size_t) e].fired ? 1 : 0;
+        }
+
+        auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+        expect (fired > 0, "nothing fired");
+        return seconds * 1.0e9 / (static_cast<double> (numBlocks) * blockSize);
+    }
+};
+
+static SequencerBenchmarks sequencerBenchmarks;